@@ -0,0 +1,1019 @@
+#pragma once
+
+#include "set.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Set of unique values kept in a B-tree: every node stores up to `node_capacity` values contiguously
+// (about `NodeBytes` bytes per node), so a lookup touches O(log_B n) nodes instead of O(log n).
+//
+// The interface follows `set`, with these differences:
+// - insert and erase invalidate all iterators, references and pointers into the set;
+// - `T` must be nothrow move constructible, values are moved between nodes;
+// - there are no node handles, split/join, set operations, order statistics or balancing policies.
+// Here h = O(log_B n) is the height of the tree and B = node_capacity.
+template <typename T, typename Compare = std::less<T>, typename Allocator = std::allocator<T>, size_t NodeBytes = 256>
+class btree_set {
+  static_assert(std::is_nothrow_move_constructible_v<T>, "btree_set moves values between nodes");
+
+  struct internal_node;
+
+  struct node_header {
+    internal_node* parent = nullptr;
+    uint16_t position = 0;
+    uint16_t count = 0;
+    bool leaf = true;
+  };
+
+  static constexpr size_t values_per_node =
+      std::clamp<size_t>((NodeBytes > sizeof(node_header) ? NodeBytes - sizeof(node_header) : 0) / sizeof(T), 3,
+                         UINT16_MAX - 1);
+
+public:
+  static constexpr size_t node_capacity = values_per_node;
+
+private:
+  // Non-root nodes hold at least `min_count` values.
+  static constexpr size_t min_count = node_capacity / 2;
+
+  // A tree with n <= SIZE_MAX values is not higher than this, nodes have at least 2 children.
+  static constexpr size_t max_height = 64;
+
+  struct leaf_node : node_header {
+    leaf_node() noexcept {}
+
+    ~leaf_node() {}
+
+    union {
+      T values[node_capacity];
+    };
+  };
+
+  struct internal_node : leaf_node {
+    leaf_node* children[node_capacity + 1];
+  };
+
+  using leaf_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<leaf_node>;
+  using leaf_traits = std::allocator_traits<leaf_allocator>;
+  using internal_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<internal_node>;
+  using internal_traits = std::allocator_traits<internal_allocator>;
+
+  template <typename K>
+  static constexpr bool comparable_key =
+      set_detail::transparent<Compare> && !std::is_convertible_v<K, const T&> && requires(const Compare& c, const K& k,
+                                                                                           const T& v) {
+        { c(k, v) } -> std::convertible_to<bool>;
+        { c(v, k) } -> std::convertible_to<bool>;
+      };
+
+public:
+  using key_type = T;
+  using value_type = T;
+
+  using key_compare = Compare;
+  using value_compare = Compare;
+
+  using allocator_type = Allocator;
+
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+
+  using reference = T&;
+  using const_reference = const T&;
+
+  using pointer = T*;
+  using const_pointer = const T*;
+
+  class const_iterator {
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = std::remove_cv_t<T>;
+    using difference_type = std::ptrdiff_t;
+    using reference = const T&;
+    using pointer = const T*;
+
+    const_iterator() = default;
+
+    reference operator*() const noexcept {
+      return node->values[index];
+    }
+
+    pointer operator->() const noexcept {
+      return &**this;
+    }
+
+    const_iterator& operator++() noexcept {
+      if (!node->leaf) {
+        node = leftmost_leaf(children(node)[index + 1]);
+        index = 0;
+        return *this;
+      }
+      if (++index < node->count) {
+        return *this;
+      }
+      leaf_node* x = node;
+      size_t i = index;
+      while (x->parent && i == x->count) {
+        i = x->position;
+        x = x->parent;
+      }
+      if (i < x->count) {
+        node = x;
+        index = i;
+      }
+      return *this;
+    }
+
+    const_iterator operator++(int) noexcept {
+      const_iterator result = *this;
+      ++*this;
+      return result;
+    }
+
+    const_iterator& operator--() noexcept {
+      if (!node->leaf) {
+        node = rightmost_leaf(children(node)[index]);
+        index = node->count - 1;
+        return *this;
+      }
+      if (index > 0) {
+        --index;
+        return *this;
+      }
+      leaf_node* x = node;
+      while (x->position == 0) {
+        x = x->parent;
+      }
+      index = x->position - 1;
+      node = x->parent;
+      return *this;
+    }
+
+    const_iterator operator--(int) noexcept {
+      const_iterator result = *this;
+      --*this;
+      return result;
+    }
+
+    friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept {
+      return lhs.node == rhs.node && lhs.index == rhs.index;
+    }
+
+    friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) noexcept {
+      return !(lhs == rhs);
+    }
+
+  private:
+    const_iterator(leaf_node* node, size_t index) noexcept : node(node), index(index) {}
+
+    leaf_node* node = nullptr;
+    size_t index = 0;
+
+    friend btree_set;
+  };
+
+  using iterator = const_iterator;
+
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+public:
+  // O(1) nothrow
+  btree_set() = default;
+
+  // O(1)
+  explicit btree_set(const Compare& comp, const Allocator& alloc = Allocator()) : comp(comp), alloc(alloc) {}
+
+  // O(1)
+  explicit btree_set(const Allocator& alloc) : alloc(alloc) {}
+
+  // O(n) if [first, last) is sorted, O(n log n) otherwise, strong
+  template <std::input_iterator InputIt>
+  btree_set(InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+      : btree_set(comp, alloc) {
+    for (; first != last; ++first) {
+      insert(end(), *first);
+    }
+  }
+
+  // O(n) strong
+  template <std::input_iterator InputIt>
+  btree_set(sorted_unique_t, InputIt first, InputIt last, const Compare& comp = Compare(),
+            const Allocator& alloc = Allocator())
+      : btree_set(comp, alloc) {
+    for (; first != last; ++first) {
+      append(T(*first));
+    }
+  }
+
+  // O(n) strong
+  btree_set(const btree_set& other)
+      : btree_set(other, Allocator(leaf_traits::select_on_container_copy_construction(other.alloc))) {}
+
+  // O(n) strong
+  btree_set(const btree_set& other, const Allocator& alloc) : comp(other.comp), alloc(alloc) {
+    if (other.root) {
+      set_root(clone(other.root));
+      count = other.count;
+    }
+  }
+
+  // O(1) nothrow
+  btree_set(btree_set&& other) noexcept(std::is_nothrow_copy_constructible_v<Compare>)
+      : comp(other.comp), alloc(std::move(other.alloc)) {
+    swap_tree(other);
+  }
+
+  // O(1) nothrow if the allocator can be taken over, O(n) basic otherwise
+  btree_set(btree_set&& other, const Allocator& alloc) : comp(other.comp), alloc(alloc) {
+    if (this->alloc == other.alloc) {
+      swap_tree(other);
+    } else {
+      move_from(other);
+    }
+  }
+
+  // O(n) strong
+  btree_set& operator=(const btree_set& other) {
+    if (this != &other) {
+      constexpr bool propagate = leaf_traits::propagate_on_container_copy_assignment::value;
+      btree_set copy(other, Allocator(propagate ? other.alloc : alloc));
+      swap_contents(copy);
+      std::swap(alloc, copy.alloc);
+    }
+    return *this;
+  }
+
+  // O(n) if [first, last) is sorted, O(n log n) otherwise, strong
+  template <std::input_iterator InputIt>
+  void assign(InputIt first, InputIt last) {
+    btree_set result(first, last, comp, Allocator(alloc));
+    swap_contents(result);
+  }
+
+  // O(n) strong
+  template <std::input_iterator InputIt>
+  void assign(sorted_unique_t, InputIt first, InputIt last) {
+    btree_set result(sorted_unique, first, last, comp, Allocator(alloc));
+    swap_contents(result);
+  }
+
+  // O(n) nothrow if the allocator can be taken over, O(n) basic otherwise
+  btree_set& operator=(btree_set&& other) noexcept((leaf_traits::propagate_on_container_move_assignment::value ||
+                                                    leaf_traits::is_always_equal::value) &&
+                                                   std::is_nothrow_copy_assignable_v<Compare>) {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    comp = other.comp;
+    if constexpr (leaf_traits::propagate_on_container_move_assignment::value) {
+      alloc = std::move(other.alloc);
+    } else if (alloc != other.alloc) {
+      move_from(other);
+      return *this;
+    }
+    swap_tree(other);
+    return *this;
+  }
+
+  // O(n) nothrow
+  ~btree_set() noexcept {
+    clear();
+  }
+
+  // O(n) nothrow
+  void clear() noexcept {
+    if (root) {
+      destroy(root);
+    }
+    set_root(nullptr);
+    count = 0;
+  }
+
+  // O(1)
+  allocator_type get_allocator() const {
+    return allocator_type(alloc);
+  }
+
+  // O(1)
+  key_compare key_comp() const {
+    return comp;
+  }
+
+  // O(1)
+  value_compare value_comp() const {
+    return comp;
+  }
+
+  // O(1) nothrow
+  size_t size() const noexcept {
+    return count;
+  }
+
+  // O(1) nothrow
+  bool empty() const noexcept {
+    return count == 0;
+  }
+
+  // O(1) nothrow
+  const_iterator begin() const noexcept {
+    return const_iterator(leftmost, 0);
+  }
+
+  // O(1) nothrow
+  const_iterator end() const noexcept {
+    return const_iterator(rightmost, rightmost ? rightmost->count : 0);
+  }
+
+  // O(1) nothrow
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+
+  // O(1) nothrow
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  // O(B h) strong
+  std::pair<iterator, bool> insert(const T& value) {
+    auto [x, i, found] = find_position(value);
+    if (found) {
+      return {iterator(x, i), false};
+    }
+    return {insert_at(x, i, T(value)), true};
+  }
+
+  // O(B h) strong
+  std::pair<iterator, bool> insert(T&& value) {
+    auto [x, i, found] = find_position(value);
+    if (found) {
+      return {iterator(x, i), false};
+    }
+    return {insert_at(x, i, std::move(value)), true};
+  }
+
+  // O(B h) strong, a value is constructed only if it is absent when called with a single key
+  // comparable with `T` and a transparent comparator
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    if constexpr (sizeof...(Args) == 1 && (comparable_key<Args> && ...)) {
+      auto [x, i, found] = find_position(args...);
+      if (found) {
+        return {iterator(x, i), false};
+      }
+      return {insert_at(x, i, T(std::forward<Args>(args)...)), true};
+    } else {
+      T value(std::forward<Args>(args)...);
+      return insert(std::move(value));
+    }
+  }
+
+  // amortized O(B) if `value` goes right before `hint`, O(B h) otherwise, strong
+  iterator insert(const_iterator hint, const T& value) {
+    auto [x, i, found] = find_position(hint, value);
+    if (found) {
+      return iterator(x, i);
+    }
+    return insert_at(x, i, T(value));
+  }
+
+  // amortized O(B) if `value` goes right before `hint`, O(B h) otherwise, strong
+  iterator insert(const_iterator hint, T&& value) {
+    auto [x, i, found] = find_position(hint, value);
+    if (found) {
+      return iterator(x, i);
+    }
+    return insert_at(x, i, std::move(value));
+  }
+
+  // amortized O(B) if the value goes right before `hint`, O(B h) otherwise, strong
+  template <typename... Args>
+  iterator emplace_hint(const_iterator hint, Args&&... args) {
+    T value(std::forward<Args>(args)...);
+    return insert(hint, std::move(value));
+  }
+
+  // O(B h) nothrow
+  iterator erase(const_iterator pos) noexcept {
+    return erase_at(pos.node, pos.index);
+  }
+
+  // O(B h) strong
+  size_t erase(const T& value) {
+    return erase_key(value);
+  }
+
+  // O(B h) strong
+  template <typename K>
+  requires set_detail::transparent<Compare> && (!std::is_convertible_v<K&&, const_iterator>)
+  size_t erase(K&& key) {
+    return erase_key(key);
+  }
+
+  // O(log n) strong
+  const_iterator lower_bound(const T& value) const {
+    return lower_bound_position(value);
+  }
+
+  // O(log n) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator lower_bound(const K& key) const {
+    return lower_bound_position(key);
+  }
+
+  // O(log n) strong
+  const_iterator upper_bound(const T& value) const {
+    return upper_bound_position(value);
+  }
+
+  // O(log n) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator upper_bound(const K& key) const {
+    return upper_bound_position(key);
+  }
+
+  // O(log n) strong
+  const_iterator find(const T& value) const {
+    return find_key(value);
+  }
+
+  // O(log n) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator find(const K& key) const {
+    return find_key(key);
+  }
+
+  // O(1) nothrow
+  friend void swap(btree_set& lhs, btree_set& rhs) noexcept(std::is_nothrow_swappable_v<Compare>) {
+    if constexpr (leaf_traits::propagate_on_container_swap::value) {
+      using std::swap;
+      swap(lhs.alloc, rhs.alloc);
+    } else {
+      assert(lhs.alloc == rhs.alloc);
+    }
+    lhs.swap_contents(rhs);
+  }
+
+private:
+  struct position {
+    leaf_node* node;
+    size_t index;
+    bool found;
+  };
+
+  // Storage for a value outside of the nodes.
+  union slot {
+    slot() noexcept {}
+
+    ~slot() {}
+
+    T value;
+  };
+
+  static leaf_node** children(leaf_node* x) noexcept {
+    return static_cast<internal_node*>(x)->children;
+  }
+
+  static leaf_node* leftmost_leaf(leaf_node* x) noexcept {
+    while (!x->leaf) {
+      x = children(x)[0];
+    }
+    return x;
+  }
+
+  static leaf_node* rightmost_leaf(leaf_node* x) noexcept {
+    while (!x->leaf) {
+      x = children(x)[x->count];
+    }
+    return x;
+  }
+
+  static void set_child(leaf_node* parent, size_t i, leaf_node* child) noexcept {
+    children(parent)[i] = child;
+    child->parent = static_cast<internal_node*>(parent);
+    child->position = static_cast<uint16_t>(i);
+  }
+
+  void set_root(leaf_node* x) noexcept {
+    root = x;
+    if (x) {
+      x->parent = nullptr;
+      x->position = 0;
+    }
+    leftmost = x ? leftmost_leaf(x) : nullptr;
+    rightmost = x ? rightmost_leaf(x) : nullptr;
+  }
+
+  void swap_contents(btree_set& other) noexcept(std::is_nothrow_swappable_v<Compare>) {
+    using std::swap;
+    swap(comp, other.comp);
+    swap_tree(other);
+  }
+
+  void swap_tree(btree_set& other) noexcept {
+    using std::swap;
+    swap(root, other.root);
+    swap(leftmost, other.leftmost);
+    swap(rightmost, other.rightmost);
+    swap(count, other.count);
+  }
+
+  leaf_node* allocate_node(bool leaf) {
+    if (leaf) {
+      leaf_node* x = std::to_address(leaf_traits::allocate(alloc, 1));
+      return ::new (static_cast<void*>(x)) leaf_node;
+    }
+    internal_allocator internal_alloc(alloc);
+    internal_node* x = std::to_address(internal_traits::allocate(internal_alloc, 1));
+    ::new (static_cast<void*>(x)) internal_node;
+    x->leaf = false;
+    return x;
+  }
+
+  // Frees a node whose values were already destroyed or moved out.
+  void deallocate_node(leaf_node* x) noexcept {
+    if (x->leaf) {
+      x->~leaf_node();
+      leaf_traits::deallocate(alloc, x, 1);
+    } else {
+      internal_node* y = static_cast<internal_node*>(x);
+      y->~internal_node();
+      internal_allocator internal_alloc(alloc);
+      internal_traits::deallocate(internal_alloc, y, 1);
+    }
+  }
+
+  void destroy(leaf_node* x) noexcept {
+    if (!x->leaf) {
+      for (size_t i = 0; i <= x->count; ++i) {
+        destroy(children(x)[i]);
+      }
+    }
+    destroy_values(x);
+    deallocate_node(x);
+  }
+
+  void destroy_values(leaf_node* x) noexcept {
+    for (size_t i = 0; i < x->count; ++i) {
+      leaf_traits::destroy(alloc, x->values + i);
+    }
+  }
+
+  // Moves the value at `from` to the uninitialized `to`.
+  void relocate(T* to, T* from) noexcept {
+    leaf_traits::construct(alloc, to, std::move(*from));
+    leaf_traits::destroy(alloc, from);
+  }
+
+  // Moves `n` values and, for internal nodes, the `n` children after them to `to` starting at `to_index`.
+  void relocate_range(leaf_node* from, size_t from_index, leaf_node* to, size_t to_index, size_t n) noexcept {
+    for (size_t i = 0; i < n; ++i) {
+      relocate(to->values + to_index + i, from->values + from_index + i);
+    }
+    if (!from->leaf) {
+      for (size_t i = 1; i <= n; ++i) {
+        set_child(to, to_index + i, children(from)[from_index + i]);
+      }
+    }
+  }
+
+  // Inserts `*value` at index `i` of a non-full node `x`, and `right` as the child after it for internal nodes.
+  void place(leaf_node* x, size_t i, T* value, leaf_node* right) noexcept {
+    for (size_t j = x->count; j > i; --j) {
+      relocate(x->values + j, x->values + j - 1);
+    }
+    relocate(x->values + i, value);
+    if (!x->leaf) {
+      for (size_t j = x->count + 1; j > i + 1; --j) {
+        set_child(x, j, children(x)[j - 1]);
+      }
+      set_child(x, i + 1, right);
+    }
+    ++x->count;
+  }
+
+  // Removes the value at index `i` and, for internal nodes, the child after it.
+  void remove(leaf_node* x, size_t i) noexcept {
+    leaf_traits::destroy(alloc, x->values + i);
+    for (size_t j = i + 1; j < x->count; ++j) {
+      relocate(x->values + j - 1, x->values + j);
+    }
+    if (!x->leaf) {
+      for (size_t j = i + 2; j <= x->count; ++j) {
+        set_child(x, j - 1, children(x)[j]);
+      }
+    }
+    --x->count;
+  }
+
+  template <typename K>
+  size_t lower_index(const leaf_node* x, const K& key) const {
+    return std::partition_point(x->values, x->values + x->count, [&](const T& v) { return comp(v, key); }) - x->values;
+  }
+
+  template <typename K>
+  size_t upper_index(const leaf_node* x, const K& key) const {
+    return std::partition_point(x->values, x->values + x->count, [&](const T& v) { return !comp(key, v); }) -
+           x->values;
+  }
+
+  // Returns the position of the value equal to `key` or the leaf position where it belongs.
+  template <typename K>
+  position find_position(const K& key) const {
+    leaf_node* x = root;
+    if (!x) {
+      return {nullptr, 0, false};
+    }
+    for (;;) {
+      size_t i = lower_index(x, key);
+      if (i < x->count && !comp(key, x->values[i])) {
+        return {x, i, true};
+      }
+      if (x->leaf) {
+        return {x, i, false};
+      }
+      x = children(x)[i];
+    }
+  }
+
+  // Same as above, but takes O(1) comparisons if `value` belongs right before `hint`.
+  position find_position(const_iterator hint, const T& value) const {
+    if (hint == end()) {
+      if (!rightmost || comp(*std::prev(hint), value)) {
+        return {rightmost, hint.index, false};
+      }
+      return find_position(value);
+    }
+    if (comp(value, *hint) && (hint == begin() || comp(*std::prev(hint), value))) {
+      if (hint.node->leaf) {
+        return {hint.node, hint.index, false};
+      }
+      const_iterator before = std::prev(hint);
+      return {before.node, before.index + 1, false};
+    }
+    return find_position(value);
+  }
+
+  template <typename K>
+  const_iterator lower_bound_position(const K& key) const {
+    const_iterator result = end();
+    for (leaf_node* x = root; x;) {
+      size_t i = lower_index(x, key);
+      if (i < x->count) {
+        result = const_iterator(x, i);
+        if (!comp(key, x->values[i])) {
+          break;
+        }
+      }
+      x = x->leaf ? nullptr : children(x)[i];
+    }
+    return result;
+  }
+
+  template <typename K>
+  const_iterator upper_bound_position(const K& key) const {
+    const_iterator result = end();
+    for (leaf_node* x = root; x;) {
+      size_t i = upper_index(x, key);
+      if (i < x->count) {
+        result = const_iterator(x, i);
+      }
+      x = x->leaf ? nullptr : children(x)[i];
+    }
+    return result;
+  }
+
+  template <typename K>
+  const_iterator find_key(const K& key) const {
+    position p = find_position(key);
+    return p.found ? const_iterator(p.node, p.index) : end();
+  }
+
+  template <typename K>
+  size_t erase_key(const K& key) {
+    position p = find_position(key);
+    if (!p.found) {
+      return 0;
+    }
+    erase_at(p.node, p.index);
+    return 1;
+  }
+
+  // Inserts `value` into an empty tree or at index `i` of leaf `x`, splitting the full nodes above it.
+  // All nodes needed for the splits are allocated first, so the tree is unchanged if that throws.
+  iterator insert_at(leaf_node* x, size_t i, T&& value) {
+    size_t splits = 0;
+    leaf_node* y = x;
+    for (; y && y->count == node_capacity; y = y->parent) {
+      ++splits;
+    }
+    size_t new_nodes = splits + (!x || (splits > 0 && !y));
+
+    std::array<leaf_node*, max_height + 1> spare;
+    for (size_t j = 0; j < new_nodes; ++j) {
+      try {
+        spare[j] = allocate_node(j == 0);
+      } catch (...) {
+        for (size_t k = 0; k < j; ++k) {
+          deallocate_node(spare[k]);
+        }
+        throw;
+      }
+    }
+    size_t next_spare = 0;
+
+    slot carry[2];
+    leaf_traits::construct(alloc, &carry[0].value, std::move(value));
+    size_t current = 0;
+    leaf_node* carry_right = nullptr;
+    bool carrying_inserted = true;
+    const_iterator result;
+
+    if (!x) {
+      x = spare[next_spare++];
+      set_root(x);
+    }
+    for (;;) {
+      if (x->count < node_capacity) {
+        place(x, i, &carry[current].value, carry_right);
+        if (carrying_inserted) {
+          result = const_iterator(x, i);
+        }
+        break;
+      }
+
+      leaf_node* r = spare[next_spare++];
+      constexpr size_t k = node_capacity / 2;
+      T* median = &carry[1 - current].value;
+      if (i < k) {
+        relocate_range(x, k, r, 0, node_capacity - k);
+        if (!x->leaf) {
+          set_child(r, 0, children(x)[k]);
+        }
+        relocate(median, x->values + k - 1);
+        r->count = node_capacity - k;
+        x->count = k - 1;
+        place(x, i, &carry[current].value, carry_right);
+        if (carrying_inserted) {
+          result = const_iterator(x, i);
+        }
+        current = 1 - current;
+        carrying_inserted = false;
+      } else if (i == k) {
+        relocate_range(x, k, r, 0, node_capacity - k);
+        if (!x->leaf) {
+          set_child(r, 0, carry_right);
+        }
+        r->count = node_capacity - k;
+        x->count = k;
+      } else {
+        relocate_range(x, k + 1, r, 0, node_capacity - k - 1);
+        if (!x->leaf) {
+          set_child(r, 0, children(x)[k + 1]);
+        }
+        relocate(median, x->values + k);
+        r->count = node_capacity - k - 1;
+        x->count = k;
+        place(r, i - k - 1, &carry[current].value, carry_right);
+        if (carrying_inserted) {
+          result = const_iterator(r, i - k - 1);
+        }
+        current = 1 - current;
+        carrying_inserted = false;
+      }
+      carry_right = r;
+
+      if (!x->parent) {
+        leaf_node* new_root = spare[next_spare++];
+        set_child(new_root, 0, x);
+        place(new_root, 0, &carry[current].value, carry_right);
+        if (carrying_inserted) {
+          result = const_iterator(new_root, 0);
+        }
+        set_root(new_root);
+        break;
+      }
+      i = x->position;
+      x = x->parent;
+    }
+    assert(next_spare == new_nodes);
+
+    ++count;
+    leftmost = leftmost_leaf(root);
+    rightmost = rightmost_leaf(root);
+    return result;
+  }
+
+  // Appends a value greater than all values of the set.
+  void append(T&& value) {
+    if (root && !comp(*std::prev(end()), value)) {
+      return;
+    }
+    insert_at(rightmost, rightmost ? rightmost->count : 0, std::move(value));
+  }
+
+  // Erases the value at index `i` of `x` and rebalances the tree, returns the position of the next value.
+  iterator erase_at(leaf_node* x, size_t i) noexcept {
+    const_iterator next(x, i);
+    if (!x->leaf) {
+      // Swap with the successor, which is the first value of a leaf.
+      leaf_node* s = leftmost_leaf(children(x)[i + 1]);
+      slot tmp;
+      relocate(&tmp.value, x->values + i);
+      relocate(x->values + i, s->values);
+      relocate(s->values, &tmp.value);
+      x = s;
+      i = 0;
+    }
+    remove(x, i);
+    --count;
+    rebalance(x, next);
+
+    if (!root) {
+      set_root(nullptr);
+      return end();
+    }
+    leftmost = leftmost_leaf(root);
+    rightmost = rightmost_leaf(root);
+    while (next.index == next.node->count && next.node->parent) {
+      next.index = next.node->position;
+      next.node = next.node->parent;
+    }
+    return next.index == next.node->count ? end() : next;
+  }
+
+  // Restores the minimal node occupancy from `x` upwards, keeping `tracked` at the same value.
+  void rebalance(leaf_node* x, const_iterator& tracked) noexcept {
+    for (;;) {
+      if (x == root) {
+        if (x->count == 0) {
+          if (x->leaf) {
+            root = nullptr;
+          } else {
+            root = children(x)[0];
+            root->parent = nullptr;
+            root->position = 0;
+          }
+          deallocate_node(x);
+        }
+        return;
+      }
+      if (x->count >= min_count) {
+        return;
+      }
+
+      leaf_node* p = x->parent;
+      size_t i = x->position;
+      if (i > 0 && children(p)[i - 1]->count > min_count) {
+        rotate_right(p, i - 1, tracked);
+        return;
+      }
+      if (i < p->count && children(p)[i + 1]->count > min_count) {
+        rotate_left(p, i, tracked);
+        return;
+      }
+      merge_children(p, i > 0 ? i - 1 : i, tracked);
+      x = p;
+    }
+  }
+
+  // Moves the last value of child `i` of `p` up and the separator down to the front of child `i + 1`.
+  void rotate_right(leaf_node* p, size_t i, const_iterator& tracked) noexcept {
+    leaf_node* left = children(p)[i];
+    leaf_node* right = children(p)[i + 1];
+    size_t last = left->count - 1;
+    if (tracked.node == right) {
+      ++tracked.index;
+    } else if (tracked == const_iterator(p, i) || tracked == const_iterator(left, left->count)) {
+      tracked = const_iterator(right, 0);
+    } else if (tracked == const_iterator(left, last)) {
+      tracked = const_iterator(p, i);
+    }
+
+    for (size_t j = right->count; j > 0; --j) {
+      relocate(right->values + j, right->values + j - 1);
+    }
+    relocate(right->values, p->values + i);
+    relocate(p->values + i, left->values + last);
+    if (!right->leaf) {
+      for (size_t j = right->count + 1; j > 0; --j) {
+        set_child(right, j, children(right)[j - 1]);
+      }
+      set_child(right, 0, children(left)[last + 1]);
+    }
+    --left->count;
+    ++right->count;
+  }
+
+  // Moves the separator down to the back of child `i` of `p` and the first value of child `i + 1` up.
+  void rotate_left(leaf_node* p, size_t i, const_iterator& tracked) noexcept {
+    leaf_node* left = children(p)[i];
+    leaf_node* right = children(p)[i + 1];
+    if (tracked == const_iterator(p, i)) {
+      tracked = const_iterator(left, left->count);
+    } else if (tracked == const_iterator(right, 0)) {
+      tracked = const_iterator(p, i);
+    } else if (tracked.node == right) {
+      --tracked.index;
+    }
+
+    relocate(left->values + left->count, p->values + i);
+    relocate(p->values + i, right->values);
+    if (!left->leaf) {
+      set_child(left, left->count + 1, children(right)[0]);
+      for (size_t j = 1; j <= right->count; ++j) {
+        set_child(right, j - 1, children(right)[j]);
+      }
+    }
+    for (size_t j = 1; j < right->count; ++j) {
+      relocate(right->values + j - 1, right->values + j);
+    }
+    ++left->count;
+    --right->count;
+  }
+
+  // Merges child `i` of `p`, the separator and child `i + 1` into child `i`.
+  void merge_children(leaf_node* p, size_t i, const_iterator& tracked) noexcept {
+    leaf_node* left = children(p)[i];
+    leaf_node* right = children(p)[i + 1];
+    size_t left_count = left->count;
+    if (tracked == const_iterator(p, i)) {
+      tracked = const_iterator(left, left_count);
+    } else if (tracked.node == p && tracked.index > i) {
+      --tracked.index;
+    } else if (tracked.node == right) {
+      tracked = const_iterator(left, left_count + 1 + tracked.index);
+    }
+
+    relocate(left->values + left_count, p->values + i);
+    if (!left->leaf) {
+      set_child(left, left_count + 1, children(right)[0]);
+    }
+    relocate_range(right, 0, left, left_count + 1, right->count);
+    left->count = static_cast<uint16_t>(left_count + 1 + right->count);
+
+    for (size_t j = i + 1; j < p->count; ++j) {
+      relocate(p->values + j - 1, p->values + j);
+    }
+    for (size_t j = i + 2; j <= p->count; ++j) {
+      set_child(p, j - 1, children(p)[j]);
+    }
+    --p->count;
+    right->count = 0;
+    deallocate_node(right);
+  }
+
+  leaf_node* clone(const leaf_node* x) {
+    leaf_node* y = allocate_node(x->leaf);
+    size_t cloned = 0;
+    try {
+      for (; y->count < x->count; ++y->count) {
+        leaf_traits::construct(alloc, y->values + y->count, x->values[y->count]);
+      }
+      if (!x->leaf) {
+        for (; cloned <= x->count; ++cloned) {
+          set_child(y, cloned, clone(static_cast<const internal_node*>(x)->children[cloned]));
+        }
+      }
+    } catch (...) {
+      for (size_t j = 0; j < cloned; ++j) {
+        destroy(children(y)[j]);
+      }
+      destroy_values(y);
+      deallocate_node(y);
+      throw;
+    }
+    return y;
+  }
+
+  // Moves all values of `other` into new nodes of this (empty) set and clears `other`.
+  void move_from(btree_set& other) {
+    for (const_iterator it = other.begin(); it != other.end(); ++it) {
+      append(std::move(const_cast<T&>(*it)));
+    }
+    other.clear();
+  }
+
+private:
+  leaf_node* root = nullptr;
+  leaf_node* leftmost = nullptr;
+  leaf_node* rightmost = nullptr;
+  size_t count = 0;
+  [[no_unique_address]] Compare comp{};
+  [[no_unique_address]] leaf_allocator alloc{};
+};
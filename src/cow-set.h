@@ -0,0 +1,311 @@
+#pragma once
+
+#include "set.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Copy-on-write handle to a `set`: copies share one tree, and the first mutation through a handle
+// whose tree is shared clones the whole tree in O(n). Nodes carry parent pointers and the end
+// sentinel lives in the tree, so sharing only part of a tree is not possible.
+//
+// The interface follows `set`, with these differences:
+// - the first mutation of a shared set invalidates its iterators, other sets keep theirs;
+// - mutations that find nothing to change (inserting a present value, erasing an absent one) never clone;
+// - handles are not synchronized, but different handles sharing a tree may be used from different threads;
+//   for this reason self-adjusting policies, whose lookups restructure the tree, are not supported.
+template <typename T, typename Compare = std::less<T>, typename Allocator = std::allocator<std::remove_cv_t<T>>,
+          typename Policy = red_black_tree_policy>
+class cow_set {
+  static_assert(!set_detail::adjusts_on_access<Policy>, "lookups must not modify a tree shared between handles");
+
+  using tree = set<T, Compare, Allocator, Policy>;
+
+public:
+  using key_type = T;
+  using value_type = T;
+
+  using key_compare = Compare;
+  using value_compare = Compare;
+
+  using allocator_type = Allocator;
+
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+
+  using reference = T&;
+  using const_reference = const T&;
+
+  using pointer = T*;
+  using const_pointer = const T*;
+
+  using const_iterator = typename tree::const_iterator;
+  using iterator = const_iterator;
+
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+public:
+  // O(1) nothrow, allocates nothing until the first insertion
+  cow_set() = default;
+
+  // O(1)
+  explicit cow_set(const Compare& comp, const Allocator& alloc = Allocator()) : comp(comp), alloc(alloc) {}
+
+  // O(1) strong, takes over the nodes of `s`
+  explicit cow_set(tree&& s)
+      : shared(std::allocate_shared<tree>(s.get_allocator(), std::move(s))), comp(shared->key_comp()),
+        alloc(shared->get_allocator()) {}
+
+  // O(n) if [first, last) is sorted, O(n log n) otherwise, strong
+  template <std::input_iterator InputIt>
+  cow_set(InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+      : cow_set(tree(first, last, comp, alloc)) {}
+
+  // O(1) nothrow, the copy shares the tree
+  cow_set(const cow_set& other) noexcept(std::is_nothrow_copy_constructible_v<Compare>) = default;
+
+  // O(1) nothrow
+  cow_set(cow_set&& other) noexcept(std::is_nothrow_copy_constructible_v<Compare>)
+      : shared(std::move(other.shared)), comp(other.comp), alloc(other.alloc) {}
+
+  // O(1) strong, plus O(n) nothrow if this was the last handle to the old tree
+  cow_set& operator=(const cow_set& other) {
+    if (this != &other) {
+      cow_set copy(other);
+      swap(*this, copy);
+    }
+    return *this;
+  }
+
+  // O(1) nothrow, plus O(n) if this was the last handle to the old tree
+  cow_set& operator=(cow_set&& other) noexcept(std::is_nothrow_swappable_v<Compare>) {
+    if (this != &other) {
+      cow_set moved(std::move(other));
+      swap(*this, moved);
+    }
+    return *this;
+  }
+
+  // O(n) nothrow if this is the last handle to the tree, O(1) nothrow otherwise
+  ~cow_set() = default;
+
+  // O(1) nothrow, same as above
+  void clear() noexcept {
+    shared.reset();
+  }
+
+  // O(1)
+  allocator_type get_allocator() const {
+    return alloc;
+  }
+
+  // O(1)
+  key_compare key_comp() const {
+    return comp;
+  }
+
+  // O(1)
+  value_compare value_comp() const {
+    return comp;
+  }
+
+  // O(1) nothrow
+  size_t size() const noexcept {
+    return shared ? shared->size() : 0;
+  }
+
+  // O(1) nothrow
+  bool empty() const noexcept {
+    return size() == 0;
+  }
+
+  // O(1) nothrow
+  const_iterator begin() const noexcept {
+    return shared ? shared->begin() : const_iterator();
+  }
+
+  // O(1) nothrow
+  const_iterator end() const noexcept {
+    return shared ? shared->end() : const_iterator();
+  }
+
+  // O(1) nothrow
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+
+  // O(1) nothrow
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  // O(h) strong, plus O(n) if the tree is shared and `value` is absent
+  std::pair<iterator, bool> insert(const T& value) {
+    return insert_key(value);
+  }
+
+  // O(h) strong, same as above
+  std::pair<iterator, bool> insert(T&& value) {
+    return insert_key(std::move(value));
+  }
+
+  // amortized O(1) if `value` goes right before `hint`, O(h) otherwise, strong;
+  // plus O(n) if the tree is shared and `value` is absent
+  iterator insert(const_iterator hint, const T& value) {
+    return insert_hint(hint, value);
+  }
+
+  // amortized O(1) if `value` goes right before `hint`, O(h) otherwise, strong; same as above
+  iterator insert(const_iterator hint, T&& value) {
+    return insert_hint(hint, std::move(value));
+  }
+
+  // O(h) strong, plus O(n) if the tree is shared and the value is absent;
+  // a shared tree is searched with a value constructed from `args` first
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    if (shared && shared.use_count() > 1) {
+      return insert_key(T(std::forward<Args>(args)...));
+    }
+    return unshare().emplace(std::forward<Args>(args)...);
+  }
+
+  // amortized O(1) if the value goes right before `hint`, O(h) otherwise, strong;
+  // plus O(n) if the tree is shared and the value is absent
+  template <typename... Args>
+  iterator emplace_hint(const_iterator hint, Args&&... args) {
+    if (shared && shared.use_count() > 1) {
+      return insert_hint(hint, T(std::forward<Args>(args)...));
+    }
+    tree& t = unshare(&hint);
+    return t.emplace_hint(hint, std::forward<Args>(args)...);
+  }
+
+  // O(h) nothrow if the tree is not shared, O(n) strong otherwise
+  iterator erase(const_iterator pos) {
+    tree& t = unshare(&pos);
+    return t.erase(pos);
+  }
+
+  // O(h) strong, plus O(n) if the tree is shared and `value` is present
+  size_t erase(const T& value) {
+    return erase_key(value);
+  }
+
+  // O(h) strong, same as above
+  template <typename K>
+  requires set_detail::transparent<Compare> && (!std::is_convertible_v<K&&, const_iterator>)
+  size_t erase(K&& key) {
+    return erase_key(key);
+  }
+
+  // O(h) strong
+  const_iterator lower_bound(const T& value) const {
+    return shared ? shared->lower_bound(value) : end();
+  }
+
+  // O(h) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator lower_bound(const K& key) const {
+    return shared ? shared->lower_bound(key) : end();
+  }
+
+  // O(h) strong
+  const_iterator upper_bound(const T& value) const {
+    return shared ? shared->upper_bound(value) : end();
+  }
+
+  // O(h) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator upper_bound(const K& key) const {
+    return shared ? shared->upper_bound(key) : end();
+  }
+
+  // O(h) strong
+  const_iterator find(const T& value) const {
+    return shared ? shared->find(value) : end();
+  }
+
+  // O(h) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator find(const K& key) const {
+    return shared ? shared->find(key) : end();
+  }
+
+  // O(1) nothrow
+  friend void swap(cow_set& lhs, cow_set& rhs) noexcept(std::is_nothrow_swappable_v<Compare>) {
+    using std::swap;
+    swap(lhs.shared, rhs.shared);
+    swap(lhs.comp, rhs.comp);
+    swap(lhs.alloc, rhs.alloc);
+  }
+
+private:
+  // Makes the tree private to this handle, moving `pos` (if given) to the same position in the new tree.
+  tree& unshare(const_iterator* pos = nullptr) {
+    if (!shared) {
+      shared = std::allocate_shared<tree>(alloc, comp, alloc);
+      if (pos) {
+        *pos = shared->end();
+      }
+    } else if (shared.use_count() > 1) {
+      std::shared_ptr<tree> copy = std::allocate_shared<tree>(alloc, *shared);
+      if (pos) {
+        *pos = *pos == shared->end() ? copy->end() : copy->find(**pos);
+      }
+      shared = std::move(copy);
+    } else {
+      // `use_count` is a relaxed load; pairs with the release decrement of a handle dropped on another thread,
+      // so its last reads of the tree happen before the writes below.
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *shared;
+  }
+
+  template <typename V>
+  std::pair<iterator, bool> insert_key(V&& value) {
+    if (shared && shared.use_count() > 1) {
+      const_iterator it = shared->find(value);
+      if (it != shared->end()) {
+        return {it, false};
+      }
+    }
+    return unshare().insert(std::forward<V>(value));
+  }
+
+  template <typename V>
+  iterator insert_hint(const_iterator hint, V&& value) {
+    if (shared && shared.use_count() > 1) {
+      const_iterator it = shared->find(value);
+      if (it != shared->end()) {
+        return it;
+      }
+    }
+    tree& t = unshare(&hint);
+    return t.insert(hint, std::forward<V>(value));
+  }
+
+  template <typename K>
+  size_t erase_key(const K& key) {
+    if (!shared) {
+      return 0;
+    }
+    if (shared.use_count() > 1 && shared->find(key) == shared->end()) {
+      return 0;
+    }
+    return unshare().erase(key);
+  }
+
+private:
+  std::shared_ptr<tree> shared;
+  [[no_unique_address]] Compare comp{};
+  [[no_unique_address]] Allocator alloc{};
+};
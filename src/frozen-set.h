@@ -0,0 +1,391 @@
+#pragma once
+
+#include "set.h"
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Immutable set of unique values stored in one array in Eytzinger (BFS) order: the children of slot k
+// are slots 2k and 2k + 1, slot 0 is unused. Lookups descend without branches on the comparison result
+// and prefetch the slots four levels below, iteration is amortized O(1) per step.
+template <typename T, typename Compare = std::less<T>, typename Allocator = std::allocator<T>>
+class frozen_set {
+  using value_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+  using value_traits = std::allocator_traits<value_allocator>;
+
+public:
+  using key_type = T;
+  using value_type = T;
+
+  using key_compare = Compare;
+  using value_compare = Compare;
+
+  using allocator_type = Allocator;
+
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+
+  using reference = T&;
+  using const_reference = const T&;
+
+  using pointer = T*;
+  using const_pointer = const T*;
+
+  class const_iterator {
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = std::remove_cv_t<T>;
+    using difference_type = std::ptrdiff_t;
+    using reference = const T&;
+    using pointer = const T*;
+
+    const_iterator() = default;
+
+    reference operator*() const noexcept {
+      return values[index];
+    }
+
+    pointer operator->() const noexcept {
+      return &**this;
+    }
+
+    const_iterator& operator++() noexcept {
+      index = next_index(index, count);
+      return *this;
+    }
+
+    const_iterator operator++(int) noexcept {
+      const_iterator result = *this;
+      ++*this;
+      return result;
+    }
+
+    const_iterator& operator--() noexcept {
+      index = prev_index(index, count);
+      return *this;
+    }
+
+    const_iterator operator--(int) noexcept {
+      const_iterator result = *this;
+      --*this;
+      return result;
+    }
+
+    friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept {
+      return lhs.index == rhs.index;
+    }
+
+    friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) noexcept {
+      return !(lhs == rhs);
+    }
+
+  private:
+    const_iterator(const T* values, size_t count, size_t index) noexcept
+        : values(values), count(count), index(index) {}
+
+    const T* values = nullptr;
+    size_t count = 0;
+    size_t index = 0;
+
+    friend frozen_set;
+  };
+
+  using iterator = const_iterator;
+
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+public:
+  // O(1) nothrow
+  frozen_set() = default;
+
+  // O(1)
+  explicit frozen_set(const Compare& comp, const Allocator& alloc = Allocator()) : comp(comp), alloc(alloc) {}
+
+  // O(n) strong, [first, last) must be sorted and free of duplicates
+  template <std::forward_iterator ForwardIt>
+  frozen_set(sorted_unique_t, ForwardIt first, ForwardIt last, const Compare& comp = Compare(),
+             const Allocator& alloc = Allocator())
+      : comp(comp), alloc(alloc) {
+    build(first, static_cast<size_t>(std::distance(first, last)));
+  }
+
+  // O(n) strong
+  frozen_set(const frozen_set& other)
+      : comp(other.comp), alloc(value_traits::select_on_container_copy_construction(other.alloc)) {
+    build(other.begin(), other.count);
+  }
+
+  // O(1) nothrow
+  frozen_set(frozen_set&& other) noexcept(std::is_nothrow_copy_constructible_v<Compare>)
+      : comp(other.comp), alloc(std::move(other.alloc)) {
+    swap_storage(other);
+  }
+
+  // O(n) strong
+  frozen_set& operator=(const frozen_set& other) {
+    if (this != &other) {
+      frozen_set copy(other);
+      swap(*this, copy);
+    }
+    return *this;
+  }
+
+  // O(n) nothrow
+  frozen_set& operator=(frozen_set&& other) noexcept(std::is_nothrow_swappable_v<Compare>) {
+    if (this != &other) {
+      frozen_set moved(std::move(other));
+      swap(*this, moved);
+    }
+    return *this;
+  }
+
+  // O(n) nothrow
+  ~frozen_set() noexcept {
+    destroy();
+  }
+
+  // O(1)
+  allocator_type get_allocator() const {
+    return allocator_type(alloc);
+  }
+
+  // O(1)
+  key_compare key_comp() const {
+    return comp;
+  }
+
+  // O(1)
+  value_compare value_comp() const {
+    return comp;
+  }
+
+  // O(1) nothrow
+  size_t size() const noexcept {
+    return count;
+  }
+
+  // O(1) nothrow
+  bool empty() const noexcept {
+    return count == 0;
+  }
+
+  // O(1) nothrow
+  const_iterator begin() const noexcept {
+    return const_iterator(values, count, first_index);
+  }
+
+  // O(1) nothrow
+  const_iterator end() const noexcept {
+    return const_iterator(values, count, 0);
+  }
+
+  // O(1) nothrow
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+
+  // O(1) nothrow
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  // O(log n) strong
+  const_iterator lower_bound(const T& value) const {
+    return lower_bound_key(value);
+  }
+
+  // O(log n) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator lower_bound(const K& key) const {
+    return lower_bound_key(key);
+  }
+
+  // O(log n) strong
+  const_iterator upper_bound(const T& value) const {
+    return upper_bound_key(value);
+  }
+
+  // O(log n) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator upper_bound(const K& key) const {
+    return upper_bound_key(key);
+  }
+
+  // O(log n) strong
+  const_iterator find(const T& value) const {
+    return find_key(value);
+  }
+
+  // O(log n) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator find(const K& key) const {
+    return find_key(key);
+  }
+
+  // O(log n) strong
+  bool contains(const T& value) const {
+    return find_key(value) != end();
+  }
+
+  // O(log n) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  bool contains(const K& key) const {
+    return find_key(key) != end();
+  }
+
+  // O(1) nothrow
+  friend void swap(frozen_set& lhs, frozen_set& rhs) noexcept(std::is_nothrow_swappable_v<Compare>) {
+    using std::swap;
+    swap(lhs.comp, rhs.comp);
+    if constexpr (value_traits::propagate_on_container_swap::value) {
+      swap(lhs.alloc, rhs.alloc);
+    } else {
+      assert(lhs.alloc == rhs.alloc);
+    }
+    lhs.swap_storage(rhs);
+  }
+
+private:
+  // Slot after `k` in sorted order, 0 after the last one.
+  static size_t next_index(size_t k, size_t n) noexcept {
+    if (2 * k + 1 <= n) {
+      k = 2 * k + 1;
+      while (2 * k <= n) {
+        k *= 2;
+      }
+      return k;
+    }
+    return k >> (std::countr_one(k) + 1);
+  }
+
+  // Slot before `k` in sorted order, the last one for 0.
+  static size_t prev_index(size_t k, size_t n) noexcept {
+    if (k == 0) {
+      k = 1;
+      while (2 * k + 1 <= n) {
+        k = 2 * k + 1;
+      }
+      return k;
+    }
+    if (2 * k <= n) {
+      k = 2 * k;
+      while (2 * k + 1 <= n) {
+        k = 2 * k + 1;
+      }
+      return k;
+    }
+    return k >> (std::countr_zero(k) + 1);
+  }
+
+  static size_t leftmost_index(size_t n) noexcept {
+    return n == 0 ? 0 : std::bit_floor(n);
+  }
+
+  void prefetch([[maybe_unused]] size_t k) const noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    // The 16 slots four levels below `k` are adjacent.
+    if (16 * k <= count) {
+      __builtin_prefetch(values + 16 * k);
+    }
+#endif
+  }
+
+  // Descends to a leaf going right whenever `go_right(slot)` holds, then climbs back to the
+  // last slot where it went left, which is the first slot in sorted order that failed `go_right`.
+  template <typename GoRight>
+  size_t descend(GoRight go_right) const {
+    size_t k = 1;
+    while (k <= count) {
+      prefetch(k);
+      k = 2 * k + static_cast<size_t>(go_right(values[k]));
+    }
+    return k >> (std::countr_one(k) + 1);
+  }
+
+  template <typename K>
+  const_iterator lower_bound_key(const K& key) const {
+    return const_iterator(values, count, descend([&](const T& v) { return comp(v, key); }));
+  }
+
+  template <typename K>
+  const_iterator upper_bound_key(const K& key) const {
+    return const_iterator(values, count, descend([&](const T& v) { return !comp(key, v); }));
+  }
+
+  template <typename K>
+  const_iterator find_key(const K& key) const {
+    const_iterator it = lower_bound_key(key);
+    if (it.index != 0 && comp(key, *it)) {
+      return end();
+    }
+    return it;
+  }
+
+  // Copies `n` sorted values starting at `first` into the slots in sorted order.
+  template <typename It>
+  void build(It first, size_t n) {
+    if (n == 0) {
+      return;
+    }
+    T* storage = std::to_address(value_traits::allocate(alloc, n + 1));
+    size_t k = leftmost_index(n);
+    try {
+      for (; k != 0; k = next_index(k, n), ++first) {
+        value_traits::construct(alloc, storage + k, *first);
+      }
+    } catch (...) {
+      for (size_t j = leftmost_index(n); j != k; j = next_index(j, n)) {
+        value_traits::destroy(alloc, storage + j);
+      }
+      value_traits::deallocate(alloc, storage, n + 1);
+      throw;
+    }
+    values = storage;
+    count = n;
+    first_index = leftmost_index(n);
+  }
+
+  void destroy() noexcept {
+    if (!values) {
+      return;
+    }
+    for (size_t k = 1; k <= count; ++k) {
+      value_traits::destroy(alloc, values + k);
+    }
+    value_traits::deallocate(alloc, values, count + 1);
+    values = nullptr;
+    count = 0;
+    first_index = 0;
+  }
+
+  void swap_storage(frozen_set& other) noexcept {
+    using std::swap;
+    swap(values, other.values);
+    swap(count, other.count);
+    swap(first_index, other.first_index);
+  }
+
+private:
+  T* values = nullptr;
+  size_t count = 0;
+  size_t first_index = 0;
+  [[no_unique_address]] Compare comp{};
+  [[no_unique_address]] value_allocator alloc{};
+};
+
+// O(n) strong, an immutable copy of `s` laid out for fast lookups
+template <typename T, typename Compare, typename Allocator, typename Policy>
+frozen_set<T, Compare, Allocator> freeze(const set<T, Compare, Allocator, Policy>& s) {
+  return frozen_set<T, Compare, Allocator>(sorted_unique, s.begin(), s.end(), s.key_comp(), s.get_allocator());
+}
@@ -0,0 +1,587 @@
+#pragma once
+
+#include "set.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// Immutable set of unique values whose versions share structure. Copying a version is O(1), and
+// `insert`/`erase` return a new version that copies only the O(log n) nodes on the changed path,
+// keeping every other node shared with the old version through reference counts.
+//
+// The tree is an AVL tree, so h <= 1.45 log(n + 2). Versions may be copied, read and destroyed
+// from several threads at once, as long as `T`, the comparator and the allocator allow it.
+// Iterators stay valid while the version they were obtained from, or a copy of it, is alive: they keep
+// the path from its root to their node, which other versions sharing the node may not contain. The path
+// is stored inline (`max_height` pointers), copies of an iterator copy only the part in use.
+template <typename T, typename Compare = std::less<T>, typename Allocator = std::allocator<T>>
+class persistent_set {
+  struct node {
+    node() noexcept {}
+
+    ~node() {}
+
+    node* left = nullptr;
+    node* right = nullptr;
+    std::atomic<size_t> refs = 1;
+    uint8_t height = 1;
+
+    union {
+      T value;
+    };
+  };
+
+  using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+  using node_traits = std::allocator_traits<node_allocator>;
+
+  // An AVL tree of 2^58 nodes, more than fits in memory, is not higher than this.
+  static constexpr size_t max_height = 88;
+
+  // Owning reference to a node, releases it on destruction.
+  class node_ref {
+  public:
+    node_ref(node_allocator& alloc, node* x = nullptr) noexcept : alloc(&alloc), x(x) {}
+
+    node_ref(node_ref&& other) noexcept : alloc(other.alloc), x(std::exchange(other.x, nullptr)) {}
+
+    node_ref& operator=(node_ref&&) = delete;
+
+    ~node_ref() noexcept {
+      persistent_set::release(*alloc, x);
+    }
+
+    node* get() const noexcept {
+      return x;
+    }
+
+    node* operator->() const noexcept {
+      return x;
+    }
+
+    node* release() noexcept {
+      return std::exchange(x, nullptr);
+    }
+
+  private:
+    node_allocator* alloc;
+    node* x;
+  };
+
+public:
+  using key_type = T;
+  using value_type = T;
+
+  using key_compare = Compare;
+  using value_compare = Compare;
+
+  using allocator_type = Allocator;
+
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+
+  using reference = T&;
+  using const_reference = const T&;
+
+  using pointer = T*;
+  using const_pointer = const T*;
+
+  // Keeps the path from the root to the current node, end() has an empty path.
+  class const_iterator {
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = std::remove_cv_t<T>;
+    using difference_type = std::ptrdiff_t;
+    using reference = const T&;
+    using pointer = const T*;
+
+    const_iterator() = default;
+
+    const_iterator(const const_iterator& other) noexcept : root(other.root), depth(other.depth) {
+      std::copy_n(other.path.begin(), depth, path.begin());
+    }
+
+    const_iterator& operator=(const const_iterator& other) noexcept {
+      root = other.root;
+      depth = other.depth;
+      std::copy_n(other.path.begin(), depth, path.begin());
+      return *this;
+    }
+
+    reference operator*() const noexcept {
+      return path[depth - 1]->value;
+    }
+
+    pointer operator->() const noexcept {
+      return &**this;
+    }
+
+    const_iterator& operator++() noexcept {
+      const node* x = path[depth - 1];
+      if (x->right) {
+        push_leftmost(x->right);
+        return *this;
+      }
+      for (--depth; depth != 0 && path[depth - 1]->right == x; --depth) {
+        x = path[depth - 1];
+      }
+      return *this;
+    }
+
+    const_iterator operator++(int) noexcept {
+      const_iterator result = *this;
+      ++*this;
+      return result;
+    }
+
+    const_iterator& operator--() noexcept {
+      if (depth == 0) {
+        push_rightmost(root);
+        return *this;
+      }
+      const node* x = path[depth - 1];
+      if (x->left) {
+        push_rightmost(x->left);
+        return *this;
+      }
+      for (--depth; depth != 0 && path[depth - 1]->left == x; --depth) {
+        x = path[depth - 1];
+      }
+      return *this;
+    }
+
+    const_iterator operator--(int) noexcept {
+      const_iterator result = *this;
+      --*this;
+      return result;
+    }
+
+    friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept {
+      return lhs.current() == rhs.current();
+    }
+
+    friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) noexcept {
+      return !(lhs == rhs);
+    }
+
+  private:
+    explicit const_iterator(const node* root) noexcept : root(root) {}
+
+    const node* current() const noexcept {
+      return depth == 0 ? nullptr : path[depth - 1];
+    }
+
+    void push_leftmost(const node* x) noexcept {
+      for (; x; x = x->left) {
+        path[depth++] = x;
+      }
+    }
+
+    void push_rightmost(const node* x) noexcept {
+      for (; x; x = x->right) {
+        path[depth++] = x;
+      }
+    }
+
+    const node* root = nullptr;
+    std::array<const node*, max_height> path;
+    size_t depth = 0;
+
+    friend persistent_set;
+  };
+
+  using iterator = const_iterator;
+
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+public:
+  // O(1) nothrow
+  persistent_set() = default;
+
+  // O(1)
+  explicit persistent_set(const Compare& comp, const Allocator& alloc = Allocator()) : comp(comp), alloc(alloc) {}
+
+  // O(n log n) strong
+  template <std::input_iterator InputIt>
+  persistent_set(InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+      : persistent_set(comp, alloc) {
+    for (; first != last; ++first) {
+      *this = insert(*first);
+    }
+  }
+
+  // O(n) strong, [first, last) must be sorted and free of duplicates
+  template <std::forward_iterator ForwardIt>
+  persistent_set(sorted_unique_t, ForwardIt first, ForwardIt last, const Compare& comp = Compare(),
+                 const Allocator& alloc = Allocator())
+      : persistent_set(comp, alloc) {
+    size_t n = static_cast<size_t>(std::distance(first, last));
+    root = build_sorted(first, n).release();
+    count = n;
+  }
+
+  // O(1) nothrow, the copy shares all nodes
+  persistent_set(const persistent_set& other) noexcept(std::is_nothrow_copy_constructible_v<Compare>)
+      : root(retain(other.root)), count(other.count), comp(other.comp), alloc(other.alloc) {}
+
+  // O(1) nothrow
+  persistent_set(persistent_set&& other) noexcept(std::is_nothrow_copy_constructible_v<Compare>)
+      : root(std::exchange(other.root, nullptr)), count(std::exchange(other.count, 0)), comp(other.comp),
+        alloc(other.alloc) {}
+
+  // O(1) strong, nodes that only the old contents used are released
+  persistent_set& operator=(const persistent_set& other) {
+    if (this != &other) {
+      persistent_set copy(other);
+      swap(*this, copy);
+    }
+    return *this;
+  }
+
+  // O(1) strong
+  persistent_set& operator=(persistent_set&& other) noexcept(std::is_nothrow_swappable_v<Compare>) {
+    if (this != &other) {
+      persistent_set moved(std::move(other));
+      swap(*this, moved);
+    }
+    return *this;
+  }
+
+  // O(number of nodes used only by this version) nothrow
+  ~persistent_set() noexcept {
+    release(alloc, root);
+  }
+
+  // O(1)
+  allocator_type get_allocator() const {
+    return allocator_type(alloc);
+  }
+
+  // O(1)
+  key_compare key_comp() const {
+    return comp;
+  }
+
+  // O(1)
+  value_compare value_comp() const {
+    return comp;
+  }
+
+  // O(1) nothrow
+  size_t size() const noexcept {
+    return count;
+  }
+
+  // O(1) nothrow
+  bool empty() const noexcept {
+    return count == 0;
+  }
+
+  // O(log n) nothrow
+  const_iterator begin() const noexcept {
+    const_iterator result(root);
+    result.push_leftmost(root);
+    return result;
+  }
+
+  // O(1) nothrow
+  const_iterator end() const noexcept {
+    return const_iterator(root);
+  }
+
+  // O(1) nothrow
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+
+  // O(log n) nothrow
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  // O(log n) strong, a new version with `value` added; the same version if it is present
+  [[nodiscard]] persistent_set insert(const T& value) const {
+    return insert_key(value);
+  }
+
+  // O(log n) strong
+  [[nodiscard]] persistent_set insert(T&& value) const {
+    return insert_key(std::move(value));
+  }
+
+  // O(log n) strong, a new version without `value`; the same version if it is absent
+  [[nodiscard]] persistent_set erase(const T& value) const {
+    return erase_key(value);
+  }
+
+  // O(log n) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  [[nodiscard]] persistent_set erase(const K& key) const {
+    return erase_key(key);
+  }
+
+  // O(log n) strong
+  const_iterator lower_bound(const T& value) const {
+    return bound([&](const T& v) { return comp(v, value); });
+  }
+
+  // O(log n) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator lower_bound(const K& key) const {
+    return bound([&](const T& v) { return comp(v, key); });
+  }
+
+  // O(log n) strong
+  const_iterator upper_bound(const T& value) const {
+    return bound([&](const T& v) { return !comp(value, v); });
+  }
+
+  // O(log n) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator upper_bound(const K& key) const {
+    return bound([&](const T& v) { return !comp(key, v); });
+  }
+
+  // O(log n) strong
+  const_iterator find(const T& value) const {
+    return find_key(value);
+  }
+
+  // O(log n) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator find(const K& key) const {
+    return find_key(key);
+  }
+
+  // O(log n) strong
+  bool contains(const T& value) const {
+    return find_key(value) != end();
+  }
+
+  // O(log n) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  bool contains(const K& key) const {
+    return find_key(key) != end();
+  }
+
+  // O(1) nothrow
+  friend void swap(persistent_set& lhs, persistent_set& rhs) noexcept(std::is_nothrow_swappable_v<Compare>) {
+    using std::swap;
+    swap(lhs.comp, rhs.comp);
+    if constexpr (node_traits::propagate_on_container_swap::value) {
+      swap(lhs.alloc, rhs.alloc);
+    } else {
+      assert(lhs.alloc == rhs.alloc);
+    }
+    swap(lhs.root, rhs.root);
+    swap(lhs.count, rhs.count);
+  }
+
+private:
+  persistent_set(node* root, size_t count, const Compare& comp, const node_allocator& alloc)
+      : root(root), count(count), comp(comp), alloc(alloc) {}
+
+  static node* retain(node* x) noexcept {
+    if (x) {
+      x->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    return x;
+  }
+
+  // Drops a reference to `x`, destroying the nodes that are no longer referenced.
+  static void release(node_allocator& alloc, node* x) noexcept {
+    while (x && x->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      release(alloc, x->left);
+      node* right = x->right;
+      node_traits::destroy(alloc, std::addressof(x->value));
+      x->~node();
+      node_traits::deallocate(alloc, x, 1);
+      x = right;
+    }
+  }
+
+  static size_t height(const node* x) noexcept {
+    return x ? x->height : 0;
+  }
+
+  node_ref ref(node* x = nullptr) const noexcept {
+    return node_ref(alloc, x);
+  }
+
+  node_ref share(node* x) const noexcept {
+    return ref(retain(x));
+  }
+
+  // Creates a node from `args` with children `l` and `r`, which are released on exception.
+  template <typename... Args>
+  node_ref make_node(node_ref l, node_ref r, Args&&... args) const {
+    node* x = std::to_address(node_traits::allocate(alloc, 1));
+    ::new (static_cast<void*>(x)) node;
+    try {
+      node_traits::construct(alloc, std::addressof(x->value), std::forward<Args>(args)...);
+    } catch (...) {
+      x->~node();
+      node_traits::deallocate(alloc, x, 1);
+      throw;
+    }
+    x->height = static_cast<uint8_t>(1 + std::max(height(l.get()), height(r.get())));
+    x->left = l.release();
+    x->right = r.release();
+    return ref(x);
+  }
+
+  // A node with `value` and children `l` and `r` whose heights differ by at most 2, rotated to be balanced.
+  node_ref balance(const T& value, node_ref l, node_ref r) const {
+    size_t hl = height(l.get());
+    size_t hr = height(r.get());
+    if (hl > hr + 1) {
+      if (height(l->left) >= height(l->right)) {
+        return make_node(share(l->left), make_node(share(l->right), std::move(r), value), l->value);
+      }
+      node* lr = l->right;
+      return make_node(make_node(share(l->left), share(lr->left), l->value),
+                       make_node(share(lr->right), std::move(r), value), lr->value);
+    }
+    if (hr > hl + 1) {
+      if (height(r->right) >= height(r->left)) {
+        return make_node(make_node(std::move(l), share(r->left), value), share(r->right), r->value);
+      }
+      node* rl = r->left;
+      return make_node(make_node(std::move(l), share(rl->left), value),
+                       make_node(share(rl->right), share(r->right), r->value), rl->value);
+    }
+    return make_node(std::move(l), std::move(r), value);
+  }
+
+  // The new subtree with `value` added, or null if it is already present in `x`.
+  template <typename V>
+  node_ref insert_into(node* x, V&& value) const {
+    if (!x) {
+      return make_node(ref(), ref(), std::forward<V>(value));
+    }
+    if (comp(value, x->value)) {
+      node_ref l = insert_into(x->left, std::forward<V>(value));
+      return l.get() ? balance(x->value, std::move(l), share(x->right)) : ref();
+    }
+    if (comp(x->value, value)) {
+      node_ref r = insert_into(x->right, std::forward<V>(value));
+      return r.get() ? balance(x->value, share(x->left), std::move(r)) : ref();
+    }
+    return ref();
+  }
+
+  // The new subtree without `key`, `erased` tells whether it was present in `x`.
+  template <typename K>
+  node_ref erase_from(node* x, const K& key, bool& erased) const {
+    if (!x) {
+      erased = false;
+      return ref();
+    }
+    if (comp(key, x->value)) {
+      node_ref l = erase_from(x->left, key, erased);
+      return erased ? balance(x->value, std::move(l), share(x->right)) : ref();
+    }
+    if (comp(x->value, key)) {
+      node_ref r = erase_from(x->right, key, erased);
+      return erased ? balance(x->value, share(x->left), std::move(r)) : ref();
+    }
+    erased = true;
+    if (!x->left || !x->right) {
+      return share(x->left ? x->left : x->right);
+    }
+    node* successor = x->right;
+    while (successor->left) {
+      successor = successor->left;
+    }
+    return balance(successor->value, share(x->left), erase_minimum(x->right));
+  }
+
+  node_ref erase_minimum(node* x) const {
+    if (!x->left) {
+      return share(x->right);
+    }
+    return balance(x->value, erase_minimum(x->left), share(x->right));
+  }
+
+  template <typename V>
+  persistent_set insert_key(V&& value) const {
+    node_ref new_root = insert_into(root, std::forward<V>(value));
+    if (!new_root.get()) {
+      return *this;
+    }
+    return persistent_set(new_root.release(), count + 1, comp, alloc);
+  }
+
+  template <typename K>
+  persistent_set erase_key(const K& key) const {
+    bool erased = false;
+    node_ref new_root = erase_from(root, key, erased);
+    if (!erased) {
+      return *this;
+    }
+    return persistent_set(new_root.release(), count - 1, comp, alloc);
+  }
+
+  // Iterator to the first value for which `go_right` is false.
+  template <typename GoRight>
+  const_iterator bound(GoRight go_right) const {
+    const_iterator result(root);
+    size_t result_depth = 0;
+    for (const node* x = root; x;) {
+      result.path[result.depth++] = x;
+      if (go_right(x->value)) {
+        x = x->right;
+      } else {
+        result_depth = result.depth;
+        x = x->left;
+      }
+    }
+    result.depth = result_depth;
+    return result;
+  }
+
+  template <typename K>
+  const_iterator find_key(const K& key) const {
+    const_iterator it = bound([&](const T& v) { return comp(v, key); });
+    if (it.depth != 0 && comp(key, *it)) {
+      return end();
+    }
+    return it;
+  }
+
+  // A perfectly balanced tree of `n` sorted values, which is a valid AVL tree.
+  template <typename It>
+  node_ref build_sorted(It& it, size_t n) const {
+    if (n == 0) {
+      return ref();
+    }
+    size_t left_size = (n - 1) / 2;
+    node_ref l = build_sorted(it, left_size);
+    node_ref x = make_node(std::move(l), ref(), *it);
+    ++it;
+    node_ref r = build_sorted(it, n - 1 - left_size);
+    x->height = static_cast<uint8_t>(1 + std::max(height(x->left), height(r.get())));
+    x->right = r.release();
+    return x;
+  }
+
+private:
+  node* root = nullptr;
+  size_t count = 0;
+  [[no_unique_address]] Compare comp{};
+  [[no_unique_address]] mutable node_allocator alloc{};
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+// Slab pool for fixed-size blocks (e.g. tree nodes) with a free list of released blocks.
+// The first requested size is served from slabs, any other size or an alignment above `std::max_align_t`
+// goes to `operator new`.
+// Memory is returned to the system only when the pool is destroyed. Not thread-safe.
+class node_pool {
+public:
+  // O(1) nothrow, allocates nothing until the first request
+  explicit node_pool(size_t max_blocks_per_slab = 4096) noexcept
+      : max_blocks_per_slab(std::max<size_t>(max_blocks_per_slab, 1)) {}
+
+  node_pool(const node_pool&) = delete;
+  node_pool& operator=(const node_pool&) = delete;
+
+  // O(number of slabs) nothrow
+  ~node_pool() noexcept {
+    while (slabs) {
+      slab_header* next = slabs->next;
+      ::operator delete(slabs);
+      slabs = next;
+    }
+  }
+
+  // amortized O(1) strong
+  void* allocate(size_t size, size_t alignment) {
+    if (!is_pooled(size, alignment)) {
+      if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        return ::operator new(size, std::align_val_t(alignment));
+      }
+      return ::operator new(size);
+    }
+    if (!free_list) {
+      add_slab();
+    }
+    free_block* result = free_list;
+    free_list = result->next;
+    return result;
+  }
+
+  // O(1) nothrow
+  void deallocate(void* ptr, size_t size, size_t alignment) noexcept {
+    if (!is_pooled(size, alignment)) {
+      if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        ::operator delete(ptr, std::align_val_t(alignment));
+      } else {
+        ::operator delete(ptr);
+      }
+      return;
+    }
+    free_list = ::new (ptr) free_block{free_list};
+  }
+
+  // O(n) nothrow, releases `n` blocks of `T` at once: pooled blocks are chained together and the chain
+  // is put in front of the free list in one step
+  template <typename T>
+  void deallocate_bulk(T* const* ptrs, size_t n) noexcept {
+    if (n == 0) {
+      return;
+    }
+    if (!is_pooled(sizeof(T), alignof(T))) {
+      for (size_t i = 0; i < n; ++i) {
+        deallocate(ptrs[i], sizeof(T), alignof(T));
+      }
+      return;
+    }
+    free_block* chain = free_list;
+    for (size_t i = n; i-- > 0;) {
+      chain = ::new (static_cast<void*>(ptrs[i])) free_block{chain};
+    }
+    free_list = chain;
+  }
+
+private:
+  struct free_block {
+    free_block* next;
+  };
+
+  struct alignas(std::max_align_t) slab_header {
+    slab_header* next;
+  };
+
+  bool is_pooled(size_t size, size_t alignment) noexcept {
+    if (block_size == 0 && alignment <= alignof(std::max_align_t)) {
+      block_size = size;
+      block_stride = round_up(std::max(size, sizeof(free_block)), std::max(alignment, alignof(free_block)));
+    }
+    return size == block_size && alignment <= alignof(std::max_align_t);
+  }
+
+  void add_slab() {
+    size_t blocks = std::min(next_slab_blocks, max_blocks_per_slab);
+    if (blocks > (std::numeric_limits<size_t>::max() - sizeof(slab_header)) / block_stride) {
+      throw std::bad_alloc();
+    }
+    void* memory = ::operator new(sizeof(slab_header) + blocks * block_stride);
+
+    slabs = ::new (memory) slab_header{slabs};
+    std::byte* first = reinterpret_cast<std::byte*>(slabs + 1);
+    for (size_t i = blocks; i-- > 0;) {
+      free_list = ::new (first + i * block_stride) free_block{free_list};
+    }
+    next_slab_blocks = std::min(blocks * 2, max_blocks_per_slab);
+  }
+
+  static size_t round_up(size_t value, size_t alignment) noexcept {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+private:
+  slab_header* slabs = nullptr;
+  free_block* free_list = nullptr;
+  size_t block_size = 0;
+  size_t block_stride = 0;
+  size_t next_slab_blocks = 8;
+  size_t max_blocks_per_slab;
+};
+
+// Allocator handle for a `node_pool` owned by the user. Copies share the pool,
+// and the allocator follows its nodes on container move assignment and swap.
+template <typename T>
+class pool_allocator {
+public:
+  using value_type = T;
+
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  explicit pool_allocator(node_pool& pool) noexcept : pool(&pool) {}
+
+  template <typename U>
+  pool_allocator(const pool_allocator<U>& other) noexcept : pool(other.pool) {}
+
+  T* allocate(size_t n) {
+    if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+    return static_cast<T*>(pool->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* ptr, size_t n) noexcept {
+    pool->deallocate(ptr, n * sizeof(T), alignof(T));
+  }
+
+  // Releases single objects allocated by this allocator.
+  void deallocate_bulk(T* const* ptrs, size_t n) noexcept {
+    pool->deallocate_bulk(ptrs, n);
+  }
+
+  friend bool operator==(const pool_allocator& lhs, const pool_allocator& rhs) noexcept {
+    return lhs.pool == rhs.pool;
+  }
+
+private:
+  node_pool* pool;
+
+  template <typename U>
+  friend class pool_allocator;
+};
@@ -1,78 +1,2589 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
-template <typename T>
+namespace set_detail {
+
+template <typename Policy>
+constexpr bool counts_subtrees = requires { requires Policy::subtree_sizes; };
+
+struct subtree_size {
+  size_t size = 1;
+};
+
+struct no_subtree_size {};
+
+template <typename Policy>
+constexpr bool threads_nodes = requires { requires Policy::in_order_links; };
+
+template <typename Policy>
+constexpr bool adjusts_on_access = requires { requires Policy::self_adjusting; };
+
+template <typename Policy>
+constexpr bool balances_by_count = requires { requires Policy::count_bounded; };
+
+// Links to the in-order neighbours, the nodes of a set and its sentinel form a cycle.
+template <typename Node>
+struct in_order_links {
+  Node* succ = nullptr;
+  Node* pred = nullptr;
+};
+
+struct no_in_order_links {};
+
+template <typename Policy>
+struct node_base : std::conditional_t<counts_subtrees<Policy>, subtree_size, no_subtree_size>,
+                   std::conditional_t<threads_nodes<Policy>, in_order_links<node_base<Policy>>, no_in_order_links> {
+  node_base* left = nullptr;
+  node_base* right = nullptr;
+  node_base* parent = nullptr;
+  [[no_unique_address]] typename Policy::node_data data{};
+};
+
+template <typename Node>
+constexpr bool has_size = std::is_base_of_v<subtree_size, Node>;
+
+template <typename Node>
+constexpr bool has_links = std::is_base_of_v<in_order_links<Node>, Node>;
+
+template <typename Node>
+size_t size(const Node* x) noexcept {
+  return x ? x->size : 0;
+}
+
+template <typename Node>
+void update_size(Node* x) noexcept {
+  if constexpr (has_size<Node>) {
+    x->size = 1 + size(x->left) + size(x->right);
+  }
+}
+
+// Updates the sizes of `x` and all its ancestors after a node was added below `x`.
+template <typename Node>
+void increment_sizes(Node* x) noexcept {
+  if constexpr (has_size<Node>) {
+    for (; x->parent; x = x->parent) {
+      ++x->size;
+    }
+  }
+}
+
+// Updates the sizes of `x` and all its ancestors before a node is removed below `x`.
+template <typename Node>
+void decrement_sizes(Node* x) noexcept {
+  if constexpr (has_size<Node>) {
+    for (; x->parent; x = x->parent) {
+      --x->size;
+    }
+  }
+}
+
+template <typename Compare>
+concept transparent = requires { typename Compare::is_transparent; };
+
+// The sentinel is the only node without a parent, the root is its left child.
+template <typename Node>
+bool is_sentinel(const Node* x) noexcept {
+  return x->parent == nullptr;
+}
+
+template <typename Node>
+bool is_root(const Node* x) noexcept {
+  return x->parent->parent == nullptr;
+}
+
+template <typename Node>
+Node* minimum(Node* x) noexcept {
+  while (x->left) {
+    x = x->left;
+  }
+  return x;
+}
+
+template <typename Node>
+Node* maximum(Node* x) noexcept {
+  while (x->right) {
+    x = x->right;
+  }
+  return x;
+}
+
+template <typename Node>
+Node* next(Node* x) noexcept {
+  if (x->right) {
+    return minimum(x->right);
+  }
+  while (x == x->parent->right) {
+    x = x->parent;
+  }
+  return x->parent;
+}
+
+template <typename Node>
+Node* prev(Node* x) noexcept {
+  if (x->left) {
+    return maximum(x->left);
+  }
+  while (x == x->parent->left) {
+    x = x->parent;
+  }
+  return x->parent;
+}
+
+// O(1) with in-order links, O(h) otherwise.
+template <typename Node>
+Node* successor(Node* x) noexcept {
+  if constexpr (has_links<Node>) {
+    return x->succ;
+  } else {
+    return next(x);
+  }
+}
+
+template <typename Node>
+Node* predecessor(Node* x) noexcept {
+  if constexpr (has_links<Node>) {
+    return x->pred;
+  } else {
+    return prev(x);
+  }
+}
+
+// Makes `b` the in-order neighbour after `a`.
+template <typename Node>
+void chain(Node* a, Node* b) noexcept {
+  if constexpr (has_links<Node>) {
+    a->succ = b;
+    b->pred = a;
+  }
+}
+
+template <typename Node>
+void replace_child(Node* parent, Node* old_child, Node* new_child) noexcept {
+  if (parent->left == old_child) {
+    parent->left = new_child;
+  } else {
+    parent->right = new_child;
+  }
+}
+
+template <typename Node>
+void rotate_left(Node* x) noexcept {
+  Node* y = x->right;
+  x->right = y->left;
+  if (y->left) {
+    y->left->parent = x;
+  }
+  y->parent = x->parent;
+  replace_child(x->parent, x, y);
+  y->left = x;
+  x->parent = y;
+  update_size(x);
+  update_size(y);
+}
+
+template <typename Node>
+void rotate_right(Node* x) noexcept {
+  Node* y = x->left;
+  x->left = y->right;
+  if (y->right) {
+    y->right->parent = x;
+  }
+  y->parent = x->parent;
+  replace_child(x->parent, x, y);
+  y->right = x;
+  x->parent = y;
+  update_size(x);
+  update_size(y);
+}
+
+// Makes `l` and `r` children of `k`, `k->parent` is left unchanged.
+template <typename Node>
+void link_children(Node* k, Node* l, Node* r) noexcept {
+  k->left = l;
+  k->right = r;
+  if (l) {
+    l->parent = k;
+  }
+  if (r) {
+    r->parent = k;
+  }
+  update_size(k);
+}
+
+template <typename Node>
+struct unlink_result {
+  // Child that took the place of the physically removed position (may be null) and its parent.
+  Node* child;
+  Node* parent;
+};
+
+// Removes `z` from the tree. If `z` has two children, its successor takes its place
+// together with `z->data`, and `z->data` is left describing the position that disappeared.
+template <typename Node>
+unlink_result<Node> unlink(Node* z) noexcept {
+  if (!z->left || !z->right) {
+    decrement_sizes(z->parent);
+    Node* child = z->left ? z->left : z->right;
+    if (child) {
+      child->parent = z->parent;
+    }
+    replace_child(z->parent, z, child);
+    return {child, z->parent};
+  }
+
+  Node* y = minimum(z->right);
+  decrement_sizes(y->parent);
+  Node* child = y->right;
+  Node* parent = y;
+  if (y->parent != z) {
+    parent = y->parent;
+    if (child) {
+      child->parent = parent;
+    }
+    parent->left = child;
+    y->right = z->right;
+    y->right->parent = y;
+  }
+  y->left = z->left;
+  y->left->parent = y;
+  y->parent = z->parent;
+  replace_child(z->parent, z, y);
+  std::swap(y->data, z->data);
+  if constexpr (has_size<Node>) {
+    y->size = z->size;
+  }
+  return {child, parent};
+}
+
+// Number of nodes in the subtree of `x`, O(1) with subtree sizes and O(size) with O(1) space otherwise.
+template <typename Node>
+size_t count_nodes(Node* x) noexcept {
+  if constexpr (has_size<Node>) {
+    return size(x);
+  } else {
+    size_t result = 0;
+    for (Node* y = x; y;) {
+      ++result;
+      if (y->left) {
+        y = y->left;
+      } else if (y->right) {
+        y = y->right;
+      } else {
+        while (y != x && (y == y->parent->right || !y->parent->right)) {
+          y = y->parent;
+        }
+        y = y == x ? nullptr : y->parent->right;
+      }
+    }
+    return result;
+  }
+}
+
+// Rebuilds the subtree of `x`, which holds `n` nodes, into a tree of minimal height in O(n) time and O(1) space
+// (Day-Stout-Warren): the subtree is rotated into a right spine and then folded back in halves.
+// Node addresses and in-order links are kept, subtree sizes are maintained by the rotations.
+template <typename Node>
+void rebuild_balanced(Node* x, size_t n) noexcept {
+  Node* parent = x->parent;
+  Node** slot = x == parent->left ? &parent->left : &parent->right;
+  while (x) {
+    if (Node* l = x->left) {
+      rotate_right(x);
+      x = l;
+    } else {
+      x = x->right;
+    }
+  }
+
+  auto compress = [slot](size_t rotations) {
+    Node* y = *slot;
+    for (size_t i = 0; i < rotations; ++i) {
+      Node* up = y->right;
+      rotate_left(y);
+      y = up->right;
+    }
+  };
+  size_t full = std::bit_floor(n + 1) - 1;
+  compress(n - full);
+  for (size_t m = full / 2; m > 0; m /= 2) {
+    compress(m);
+  }
+}
+
+// Calls `f(y, depth)` for every node `y` in the subtree of `x` in post-order, `depth` is counted from `x`.
+// O(size) time and O(1) space; `f` may change node data but not links.
+template <typename Node, typename F>
+void for_each_post_order(Node* x, F f) {
+  Node* y = x;
+  size_t depth = 0;
+  for (;;) {
+    while (y->left || y->right) {
+      y = y->left ? y->left : y->right;
+      ++depth;
+    }
+    for (;;) {
+      f(y, depth);
+      if (y == x) {
+        return;
+      }
+      Node* p = y->parent;
+      if (y == p->left && p->right) {
+        y = p->right;
+        break;
+      }
+      y = p;
+      --depth;
+    }
+  }
+}
+
+// Iterator over a sorted range that visits only the first value of every run of equivalent ones.
+template <typename It, typename Compare>
+struct distinct_iterator {
+  decltype(auto) operator*() const {
+    return *it;
+  }
+
+  distinct_iterator& operator++() {
+    It prev = it;
+    while (++it != last && !(*comp)(*prev, *it)) {}
+    return *this;
+  }
+
+  It it;
+  It last;
+  const Compare* comp;
+};
+
+enum class set_operation {
+  union_,
+  intersection,
+  difference,
+};
+
+// Below this many elements the recursion of the parallel set operations does not fork.
+inline constexpr size_t parallel_grain = 1 << 14;
+
+// Number of lookups that the batched lookups descend in lockstep.
+inline constexpr size_t lookup_group = 16;
+
+// Number of nodes whose values are destroyed before their memory is handed back to the allocator.
+inline constexpr size_t free_batch = 64;
+
+template <typename Allocator, typename Node>
+concept deallocates_in_bulk = requires(Allocator& alloc, Node* const* ptrs, size_t n) {
+  alloc.deallocate_bulk(ptrs, n);
+};
+
+inline void prefetch([[maybe_unused]] const void* ptr) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(ptr);
+#endif
+}
+
+} // namespace set_detail
+
+// Tag for constructors and `assign` whose input is known to be sorted and free of duplicates.
+struct sorted_unique_t {
+  explicit sorted_unique_t() = default;
+};
+
+inline constexpr sorted_unique_t sorted_unique{};
+
+// Tag for set operations that may run on several threads, the comparator and the allocator must be thread-safe.
+struct parallel_t {
+  explicit parallel_t() = default;
+};
+
+inline constexpr parallel_t parallel{};
+
+// Plain binary search tree: operations are O(h), where h may grow up to n.
+struct unbalanced_tree_policy {
+  struct node_data {};
+
+  template <typename Node>
+  void after_insert(Node*) noexcept {}
+
+  template <typename Node>
+  void erase(Node* z) noexcept {
+    set_detail::unlink(z);
+  }
+
+  template <typename Node>
+  void after_build(Node*, size_t, size_t) noexcept {}
+
+  // Joins detached trees `l` < `k` < `r`, returns the new root.
+  template <typename Node>
+  Node* join(Node* l, Node* k, Node* r) noexcept {
+    set_detail::link_children(k, l, r);
+    return k;
+  }
+
+  // Splits the tree containing `p` into detached trees of the nodes before `p` and of `p` with the nodes after it.
+  template <typename Node>
+  std::pair<Node*, Node*> split(Node* p) noexcept {
+    Node* y = p->parent;
+    Node* left = p->left;
+    Node* right = join(static_cast<Node*>(nullptr), p, p->right);
+    for (Node* x = p; !set_detail::is_sentinel(y);) {
+      Node* up = y->parent;
+      if (x == y->left) {
+        right = join(right, y, y->right);
+      } else {
+        left = join(y->left, y, left);
+      }
+      x = y;
+      y = up;
+    }
+    return {left, right};
+  }
+};
+
+// Red-black tree: h <= 2 log(n + 1).
+struct red_black_tree_policy {
+  struct node_data {
+    bool red = false;
+  };
+
+  template <typename Node>
+  void after_insert(Node* x) noexcept {
+    fix_red_red(x);
+  }
+
+  template <typename Node>
+  void erase(Node* z) noexcept {
+    auto [x, xp] = set_detail::unlink(z);
+    if (!z->data.red) {
+      erase_fixup(x, xp);
+    }
+  }
+
+  // Called for every node of a tree built with minimal height, where the deepest node has depth `max_depth`.
+  template <typename Node>
+  void after_build(Node* x, size_t depth, size_t max_depth) noexcept {
+    x->data.red = depth != 0 && depth == max_depth;
+  }
+
+  // Joins detached trees `l` < `k` < `r` in O(log n), returns the new root.
+  template <typename Node>
+  Node* join(Node* l, Node* k, Node* r) noexcept {
+    return join(l, black_height(l), k, r, black_height(r)).first;
+  }
+
+  // Splits the tree containing `p` into detached trees of the nodes before `p` and of `p` with the nodes after it.
+  // Each join costs O(difference of black heights + 1), which telescopes to O(log n) in total.
+  template <typename Node>
+  std::pair<Node*, Node*> split(Node* p) noexcept {
+    size_t h = black_height(p);
+    size_t children_height = h - !p->data.red;
+
+    Node* y = p->parent;
+    Node* left = p->left;
+    size_t left_height = children_height;
+    auto [right, right_height] = join(static_cast<Node*>(nullptr), 0, p, p->right, children_height);
+
+    for (Node* x = p; !set_detail::is_sentinel(y);) {
+      Node* up = y->parent;
+      size_t y_height = h + !y->data.red;
+      if (x == y->left) {
+        std::tie(right, right_height) = join(right, right_height, y, y->right, h);
+      } else {
+        std::tie(left, left_height) = join(y->left, h, y, left, left_height);
+      }
+      h = y_height;
+      x = y;
+      y = up;
+    }
+    if (left) {
+      left->data.red = false;
+    }
+    return {left, right};
+  }
+
+private:
+  template <typename Node>
+  static bool is_red(const Node* x) noexcept {
+    return x && x->data.red;
+  }
+
+  // Number of black nodes on a path from `x` down to a leaf, including `x`.
+  template <typename Node>
+  static size_t black_height(const Node* x) noexcept {
+    size_t result = 0;
+    for (; x; x = x->left) {
+      result += !x->data.red;
+    }
+    return result;
+  }
+
+  // Joins detached trees with known black heights, returns the new root and its black height.
+  template <typename Node>
+  static std::pair<Node*, size_t> join(Node* l, size_t l_height, Node* k, Node* r, size_t r_height) noexcept {
+    if (is_red(l)) {
+      l->data.red = false;
+      ++l_height;
+    }
+    if (is_red(r)) {
+      r->data.red = false;
+      ++r_height;
+    }
+    if (l_height == r_height) {
+      set_detail::link_children(k, l, r);
+      k->data.red = false;
+      k->parent = nullptr;
+      return {k, l_height + 1};
+    }
+
+    // Descend along the inner spine of the taller tree to a black node of the other tree's height
+    // and put `k` in its place.
+    bool left_taller = l_height > r_height;
+    Node header;
+    Node* parent = &header;
+    Node* c = left_taller ? l : r;
+    header.left = c;
+    c->parent = &header;
+    size_t h = left_taller ? l_height : r_height;
+    size_t target = left_taller ? r_height : l_height;
+    while (h != target || is_red(c)) {
+      h -= !c->data.red;
+      parent = c;
+      c = left_taller ? c->right : c->left;
+    }
+
+    if (left_taller) {
+      set_detail::link_children(k, c, r);
+      parent->right = k;
+    } else {
+      set_detail::link_children(k, l, c);
+      parent->left = k;
+    }
+    k->parent = parent;
+    for (Node* x = parent; x != &header; x = x->parent) {
+      set_detail::update_size(x);
+    }
+
+    bool grown = fix_red_red(k);
+    Node* root = header.left;
+    root->parent = nullptr;
+    return {root, std::max(l_height, r_height) + grown};
+  }
+
+  // Restores the invariants after `x` was linked as a new red leaf, returns whether the black height grew.
+  template <typename Node>
+  static bool fix_red_red(Node* x) noexcept {
+    x->data.red = true;
+    while (!set_detail::is_root(x) && x->parent->data.red) {
+      Node* p = x->parent;
+      Node* g = p->parent;
+      if (p == g->left) {
+        Node* u = g->right;
+        if (is_red(u)) {
+          p->data.red = false;
+          u->data.red = false;
+          g->data.red = true;
+          x = g;
+          continue;
+        }
+        if (x == p->right) {
+          set_detail::rotate_left(p);
+          p = x;
+        }
+        p->data.red = false;
+        g->data.red = true;
+        set_detail::rotate_right(g);
+        return false;
+      } else {
+        Node* u = g->left;
+        if (is_red(u)) {
+          p->data.red = false;
+          u->data.red = false;
+          g->data.red = true;
+          x = g;
+          continue;
+        }
+        if (x == p->left) {
+          set_detail::rotate_right(p);
+          p = x;
+        }
+        p->data.red = false;
+        g->data.red = true;
+        set_detail::rotate_left(g);
+        return false;
+      }
+    }
+    if (set_detail::is_root(x)) {
+      x->data.red = false;
+      return true;
+    }
+    return false;
+  }
+
+  template <typename Node>
+  static void erase_fixup(Node* x, Node* xp) noexcept {
+    while (!set_detail::is_sentinel(xp) && !is_red(x)) {
+      if (x == xp->left) {
+        Node* w = xp->right;
+        if (w->data.red) {
+          w->data.red = false;
+          xp->data.red = true;
+          set_detail::rotate_left(xp);
+          w = xp->right;
+        }
+        if (!is_red(w->left) && !is_red(w->right)) {
+          w->data.red = true;
+          x = xp;
+          xp = x->parent;
+          continue;
+        }
+        if (!is_red(w->right)) {
+          w->left->data.red = false;
+          w->data.red = true;
+          set_detail::rotate_right(w);
+          w = xp->right;
+        }
+        w->data.red = xp->data.red;
+        xp->data.red = false;
+        w->right->data.red = false;
+        set_detail::rotate_left(xp);
+      } else {
+        Node* w = xp->left;
+        if (w->data.red) {
+          w->data.red = false;
+          xp->data.red = true;
+          set_detail::rotate_right(xp);
+          w = xp->left;
+        }
+        if (!is_red(w->left) && !is_red(w->right)) {
+          w->data.red = true;
+          x = xp;
+          xp = x->parent;
+          continue;
+        }
+        if (!is_red(w->left)) {
+          w->right->data.red = false;
+          w->data.red = true;
+          set_detail::rotate_left(w);
+          w = xp->left;
+        }
+        w->data.red = xp->data.red;
+        xp->data.red = false;
+        w->left->data.red = false;
+        set_detail::rotate_right(xp);
+      }
+      return;
+    }
+    if (x) {
+      x->data.red = false;
+    }
+  }
+};
+
+// Scapegoat tree: nodes carry no balance data. An insertion deeper than log_{3/2} n rebuilds the subtree
+// of an ancestor that holds over 2/3 of its parent's subtree, and the whole tree is rebuilt once erasures
+// shrink it below 2/3 of its largest size since the last rebuild. While a set is changed only by insertions
+// and erasures, h <= log_{3/2} n + 1, so lookups are O(log n) and insert and erase amortized O(log n).
+// Split, join and the set operations link subtrees as the unbalanced tree does and do not check the height,
+// so after them h is bounded only by the heights of the inputs; `rebalance()` restores the bound in O(n).
+struct scapegoat_tree_policy : unbalanced_tree_policy {
+  static constexpr bool count_bounded = true;
+
+  // The tree was restructured as a whole (split, joined or rebuilt) and holds `count` nodes now.
+  void restart(size_t count) noexcept {
+    max_count = count;
+  }
+
+  // `x` was linked as a new leaf, the set holds `count` nodes now.
+  template <typename Node>
+  void after_insert(Node* x, size_t count) noexcept {
+    max_count = std::max(max_count, count);
+    size_t depth = 0;
+    for (Node* y = x; !set_detail::is_root(y); y = y->parent) {
+      ++depth;
+    }
+    if (depth <= height_bound(count)) {
+      return;
+    }
+
+    size_t size = 1;
+    for (Node* child = x;;) {
+      Node* p = child->parent;
+      size_t p_size = size + 1 + set_detail::count_nodes(child == p->left ? p->right : p->left);
+      if (3 * size > 2 * p_size || set_detail::is_root(p)) {
+        set_detail::rebuild_balanced(p, p_size);
+        return;
+      }
+      size = p_size;
+      child = p;
+    }
+  }
+
+  // A node was erased from the tree of `root`, the set holds `count` nodes now.
+  template <typename Node>
+  void after_erase(Node* root, size_t count) noexcept {
+    if (3 * count < 2 * max_count) {
+      if (root) {
+        set_detail::rebuild_balanced(root, count);
+      }
+      max_count = count;
+    }
+  }
+
+private:
+  // floor(log_{3/2} n)
+  static size_t height_bound(size_t n) noexcept {
+    size_t result = 0;
+    for (double power = 1.5; power <= static_cast<double>(n); power *= 1.5) {
+      ++result;
+    }
+    return result;
+  }
+
+  size_t max_count = 0;
+};
+
+// Splay tree: every insertion and lookup rotates the node it ends at up to the root, so operations
+// are amortized O(log n) and recently used values are found in a few steps. The height may grow up to n.
+// Lookups restructure the tree, so even const member functions must not run concurrently.
+struct splay_tree_policy {
+  static constexpr bool self_adjusting = true;
+
+  struct node_data {};
+
+  template <typename Node>
+  void after_insert(Node* x) noexcept {
+    splay(x);
+  }
+
+  template <typename Node>
+  void erase(Node* z) noexcept {
+    auto [x, xp] = set_detail::unlink(z);
+    if (!set_detail::is_sentinel(xp)) {
+      splay(xp);
+    }
+  }
+
+  template <typename Node>
+  void after_build(Node*, size_t, size_t) noexcept {}
+
+  template <typename Node>
+  static void after_access(Node* x) noexcept {
+    splay(x);
+  }
+
+  // Joins detached trees `l` < `k` < `r`, returns the new root.
+  template <typename Node>
+  Node* join(Node* l, Node* k, Node* r) noexcept {
+    set_detail::link_children(k, l, r);
+    return k;
+  }
+
+  // Splits the tree containing `p` into detached trees of the nodes before `p` and of `p` with the nodes after it.
+  template <typename Node>
+  std::pair<Node*, Node*> split(Node* p) noexcept {
+    splay(p);
+    Node* left = p->left;
+    p->left = nullptr;
+    set_detail::update_size(p);
+    return {left, p};
+  }
+
+private:
+  template <typename Node>
+  static void rotate_up(Node* x) noexcept {
+    if (x == x->parent->left) {
+      set_detail::rotate_right(x->parent);
+    } else {
+      set_detail::rotate_left(x->parent);
+    }
+  }
+
+  template <typename Node>
+  static void splay(Node* x) noexcept {
+    while (!set_detail::is_root(x)) {
+      Node* p = x->parent;
+      if (set_detail::is_root(p)) {
+        rotate_up(x);
+      } else if ((x == p->left) == (p == p->parent->left)) {
+        rotate_up(p);
+        rotate_up(x);
+      } else {
+        rotate_up(x);
+        rotate_up(x);
+      }
+    }
+  }
+};
+
+// Treap: every node gets a pseudo-random priority and the tree is kept a max-heap on them, so it has
+// the shape of a randomly built tree and h is O(log n) expected. Priorities come from a generator
+// seeded with `Seed`, which makes the shape of a set reproducible.
+template <std::uint64_t Seed = 5489>
+struct treap_policy {
+  struct node_data {
+    std::uint32_t priority = 0;
+  };
+
+  template <typename Node>
+  void after_insert(Node* x) noexcept {
+    x->data.priority = next_priority();
+    while (!set_detail::is_root(x) && x->parent->data.priority < x->data.priority) {
+      rotate_up(x);
+    }
+  }
+
+  // The successor that may take the place of `z` takes its priority as well, so the heap stays intact.
+  template <typename Node>
+  void erase(Node* z) noexcept {
+    set_detail::unlink(z);
+  }
+
+  // Priorities of a built tree are random but never exceed the priority of the parent.
+  template <typename Node>
+  void after_build(Node* x, size_t, size_t) noexcept {
+    x->data.priority = std::max({next_priority(), priority(x->left), priority(x->right)});
+  }
+
+  // Joins detached trees `l` < `k` < `r` in O(log n) expected, returns the new root.
+  template <typename Node>
+  Node* join(Node* l, Node* k, Node* r) noexcept {
+    Node header;
+    set_detail::link_children(k, l, r);
+    header.left = k;
+    k->parent = &header;
+    sift_down(k);
+    Node* root = header.left;
+    root->parent = nullptr;
+    return root;
+  }
+
+  // Splits the tree containing `p` into detached trees of the nodes before `p` and of `p` with the nodes after it,
+  // O(log n) expected: `p` is rotated up to the root, its left subtree cut off and `p` sifted back down.
+  template <typename Node>
+  std::pair<Node*, Node*> split(Node* p) noexcept {
+    while (!set_detail::is_root(p)) {
+      rotate_up(p);
+    }
+    Node* left = p->left;
+    p->left = nullptr;
+    set_detail::update_size(p);
+    Node* container = p->parent;
+    sift_down(p);
+    return {left, container->left};
+  }
+
+private:
+  template <typename Node>
+  static std::uint32_t priority(const Node* x) noexcept {
+    return x ? x->data.priority : 0;
+  }
+
+  template <typename Node>
+  static void rotate_up(Node* x) noexcept {
+    if (x == x->parent->left) {
+      set_detail::rotate_right(x->parent);
+    } else {
+      set_detail::rotate_left(x->parent);
+    }
+  }
+
+  // Rotates `x` down below its children while one of them has a higher priority.
+  template <typename Node>
+  static void sift_down(Node* x) noexcept {
+    for (;;) {
+      Node* c = priority(x->left) >= priority(x->right) ? x->left : x->right;
+      if (!c || c->data.priority <= x->data.priority) {
+        return;
+      }
+      rotate_up(c);
+    }
+  }
+
+  // splitmix64
+  std::uint32_t next_priority() noexcept {
+    std::uint64_t z = state += 0x9e3779b97f4a7c15;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return static_cast<std::uint32_t>((z ^ (z >> 31)) >> 32);
+  }
+
+  std::uint64_t state = Seed;
+};
+
+// Keeps subtree sizes in the nodes of the underlying policy, enabling `nth`, `rank`,
+// `count_in_range` and `distance` in O(h). Insert and erase become O(h) regardless of the policy.
+template <typename Policy = red_black_tree_policy>
+struct with_order_statistics : Policy {
+  static constexpr bool subtree_sizes = true;
+};
+
+// Links every node to its in-order neighbours on top of the underlying policy, making iterator
+// increment and decrement O(1) in the worst case at the cost of two pointers per node.
+// Set operations relink the result in O(n + m).
+template <typename Policy = red_black_tree_policy>
+struct with_in_order_links : Policy {
+  static constexpr bool in_order_links = true;
+};
+
+template <typename T, typename Compare = std::less<T>, typename Allocator = std::allocator<std::remove_cv_t<T>>,
+          typename Policy = red_black_tree_policy>
 class set {
+  using node_base = set_detail::node_base<Policy>;
+
+  template <typename K>
+  static constexpr bool comparable_key =
+      set_detail::transparent<Compare> && std::is_invocable_r_v<bool, const Compare&, const K&, const T&> &&
+      std::is_invocable_r_v<bool, const Compare&, const T&, const K&>;
+
+  // The value is constructed and destroyed separately through the allocator.
+  struct node : node_base {
+    node() noexcept {}
+
+    ~node() {}
+
+    union {
+      T value;
+    };
+  };
+
+  using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+  using node_traits = std::allocator_traits<node_allocator>;
+
 public:
+  using key_type = T;
   using value_type = T;
 
+  using key_compare = Compare;
+  using value_compare = Compare;
+
+  using allocator_type = Allocator;
+
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+
   using reference = T&;
   using const_reference = const T&;
 
   using pointer = T*;
   using const_pointer = const T*;
 
-  using iterator = void;
-  using const_iterator = void;
+  class const_iterator {
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = std::remove_cv_t<T>;
+    using difference_type = std::ptrdiff_t;
+    using reference = const T&;
+    using pointer = const T*;
+
+    const_iterator() = default;
+
+    reference operator*() const noexcept {
+      return static_cast<const node*>(current)->value;
+    }
+
+    pointer operator->() const noexcept {
+      return &**this;
+    }
+
+    const_iterator& operator++() noexcept {
+      current = set_detail::successor(current);
+      return *this;
+    }
+
+    const_iterator operator++(int) noexcept {
+      const_iterator result = *this;
+      ++*this;
+      return result;
+    }
+
+    const_iterator& operator--() noexcept {
+      current = set_detail::predecessor(current);
+      return *this;
+    }
+
+    const_iterator operator--(int) noexcept {
+      const_iterator result = *this;
+      --*this;
+      return result;
+    }
+
+    friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept {
+      return lhs.current == rhs.current;
+    }
+
+    friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) noexcept {
+      return !(lhs == rhs);
+    }
+
+  private:
+    explicit const_iterator(node_base* current) noexcept : current(current) {}
+
+    node_base* current = nullptr;
+
+    friend set;
+  };
+
+  using iterator = const_iterator;
 
   using reverse_iterator = std::reverse_iterator<iterator>;
   using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
+  // Owns a node extracted from a set, which can be inserted into any set with an equal allocator.
+  class node_type {
+  public:
+    using value_type = std::remove_cv_t<T>;
+    using allocator_type = Allocator;
+
+    // O(1) nothrow
+    node_type() noexcept = default;
+
+    // O(1) nothrow
+    node_type(node_type&& other) noexcept : x(std::exchange(other.x, nullptr)), alloc(std::move(other.alloc)) {
+      other.alloc.reset();
+    }
+
+    // O(1) nothrow
+    node_type& operator=(node_type&& other) noexcept {
+      if (this != &other) {
+        reset();
+        if (!alloc || node_traits::propagate_on_container_move_assignment::value) {
+          alloc = std::move(other.alloc);
+        } else {
+          assert(*alloc == *other.alloc);
+        }
+        x = std::exchange(other.x, nullptr);
+        other.alloc.reset();
+      }
+      return *this;
+    }
+
+    // O(1) nothrow
+    ~node_type() noexcept {
+      reset();
+    }
+
+    // O(1) nothrow
+    bool empty() const noexcept {
+      return x == nullptr;
+    }
+
+    // O(1) nothrow
+    explicit operator bool() const noexcept {
+      return !empty();
+    }
+
+    // O(1) nothrow, the node must not be empty
+    value_type& value() const noexcept {
+      return const_cast<value_type&>(get(x));
+    }
+
+    // O(1), the node must not be empty
+    allocator_type get_allocator() const {
+      return allocator_type(*alloc);
+    }
+
+    // O(1) nothrow
+    friend void swap(node_type& lhs, node_type& rhs) noexcept {
+      using std::swap;
+      swap(lhs.x, rhs.x);
+      swap(lhs.alloc, rhs.alloc);
+    }
+
+  private:
+    node_type(node_base* x, const node_allocator& alloc) noexcept : x(x), alloc(alloc) {}
+
+    node_base* release() noexcept {
+      alloc.reset();
+      return std::exchange(x, nullptr);
+    }
+
+    void reset() noexcept {
+      if (x) {
+        destroy_node(*alloc, x);
+      }
+      release();
+    }
+
+    node_base* x = nullptr;
+    std::optional<node_allocator> alloc;
+
+    friend set;
+  };
+
+  struct insert_return_type {
+    iterator position;
+    bool inserted;
+    node_type node;
+  };
+
 public:
   // O(1) nothrow
-  set() noexcept;
+  set() = default;
+
+  // O(1)
+  explicit set(const Compare& comp, const Allocator& alloc = Allocator()) : comp(comp), alloc(alloc) {}
+
+  // O(1)
+  explicit set(const Allocator& alloc) : alloc(alloc) {}
+
+  // O(n) if [first, last) is sorted, duplicates included, O(n log n) otherwise, strong
+  template <std::input_iterator InputIt>
+  set(InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator())
+      : set(comp, alloc) {
+    insert_range(first, last);
+  }
 
   // O(n) strong
-  set(const set& other);
+  template <std::input_iterator InputIt>
+  set(sorted_unique_t, InputIt first, InputIt last, const Compare& comp = Compare(),
+      const Allocator& alloc = Allocator())
+      : set(comp, alloc) {
+    if constexpr (std::forward_iterator<InputIt>) {
+      build_sorted(first, static_cast<size_t>(std::distance(first, last)));
+    } else {
+      insert_range(first, last);
+    }
+  }
 
   // O(n) strong
-  set& operator=(const set& other);
+  set(const set& other) : set(other, Allocator(node_traits::select_on_container_copy_construction(other.alloc))) {}
+
+  // O(n) strong
+  set(const set& other, const Allocator& alloc) : comp(other.comp), alloc(alloc), policy(other.policy) {
+    if (other.root()) {
+      set_root(clone(other.root()));
+      count = other.count;
+      thread_nodes();
+    }
+  }
+
+  // O(1) nothrow
+  set(set&& other) noexcept(std::is_nothrow_copy_constructible_v<Compare>)
+      : comp(other.comp), alloc(std::move(other.alloc)) {
+    swap_tree(other);
+  }
+
+  // O(1) nothrow if the allocator can be taken over, O(n) basic otherwise
+  set(set&& other, const Allocator& alloc) : comp(other.comp), alloc(alloc) {
+    if (this->alloc == other.alloc) {
+      swap_tree(other);
+    } else {
+      move_from(other);
+    }
+  }
+
+  // O(n) strong; reuses the nodes of this set when values and comparators are nothrow copy assignable
+  // and the allocator is kept, then only the difference in size is allocated or freed
+  set& operator=(const set& other) {
+    if (this != &other) {
+      constexpr bool propagate = node_traits::propagate_on_container_copy_assignment::value;
+      if constexpr (recycles_nodes) {
+        if (!propagate || alloc == other.alloc) {
+          assign_recycled(other);
+          return *this;
+        }
+      }
+      set copy(other, Allocator(propagate ? other.alloc : alloc));
+      swap_contents(copy);
+      std::swap(alloc, copy.alloc);
+    }
+    return *this;
+  }
+
+  // O(n) if [first, last) is sorted, duplicates included, O(n log n) otherwise, strong
+  template <std::input_iterator InputIt>
+  void assign(InputIt first, InputIt last) {
+    set result(first, last, comp, Allocator(alloc));
+    swap_contents(result);
+  }
+
+  // O(n) strong
+  template <std::input_iterator InputIt>
+  void assign(sorted_unique_t, InputIt first, InputIt last) {
+    set result(sorted_unique, first, last, comp, Allocator(alloc));
+    swap_contents(result);
+  }
+
+  // O(n) nothrow if the allocator can be taken over, O(n) basic otherwise
+  set& operator=(set&& other) noexcept((node_traits::propagate_on_container_move_assignment::value ||
+                                        node_traits::is_always_equal::value) &&
+                                       std::is_nothrow_copy_assignable_v<Compare>) {
+    if (this == &other) {
+      return *this;
+    }
+    clear();
+    comp = other.comp;
+    if constexpr (node_traits::propagate_on_container_move_assignment::value) {
+      alloc = std::move(other.alloc);
+    } else if (alloc != other.alloc) {
+      move_from(other);
+      return *this;
+    }
+    swap_tree(other);
+    return *this;
+  }
 
   // O(n) nothrow
-  ~set() noexcept;
+  ~set() noexcept {
+    clear();
+  }
 
   // O(n) nothrow
-  void clear() noexcept;
+  void clear() noexcept {
+    destroy(root());
+    sentinel.left = nullptr;
+    leftmost = nullptr;
+    rightmost = nullptr;
+    count = 0;
+    adopt_ends();
+  }
+
+  // O(1)
+  allocator_type get_allocator() const {
+    return Allocator(alloc);
+  }
+
+  // O(1)
+  key_compare key_comp() const {
+    return comp;
+  }
+
+  // O(1)
+  value_compare value_comp() const {
+    return comp;
+  }
+
+  // O(1) nothrow
+  size_t size() const noexcept {
+    return count;
+  }
 
   // O(1) nothrow
-  size_t size() const noexcept;
+  bool empty() const noexcept {
+    return count == 0;
+  }
+
+  // O(n) nothrow, number of nodes on the longest path down from the root, 0 for an empty set
+  size_t height() const noexcept {
+    size_t result = 0;
+    if (node_base* x = root()) {
+      set_detail::for_each_post_order(x, [&](node_base*, size_t depth) { result = std::max(result, depth + 1); });
+    }
+    return result;
+  }
+
+  // O(n) time and O(1) space nothrow, restructures the tree to the minimal height in place:
+  // nothing is allocated, no value is moved or compared, iterators stay valid
+  void rebalance() noexcept {
+    if (node_base* x = root()) {
+      set_detail::rebuild_balanced(x, count);
+      size_t max_depth = std::bit_width(count) - 1;
+      set_detail::for_each_post_order(root(), [&](node_base* y, size_t depth) {
+        policy.after_build(y, depth, max_depth);
+      });
+      restart_policy();
+    }
+  }
 
   // O(1) nothrow
-  bool empty() const noexcept;
+  const_iterator begin() const noexcept {
+    return const_iterator(leftmost ? leftmost : end_node());
+  }
 
-  // nothrow
-  const_iterator begin() const noexcept;
+  // O(1) nothrow
+  const_iterator end() const noexcept {
+    return const_iterator(end_node());
+  }
 
-  // nothrow
-  const_iterator end() const noexcept;
+  // O(1) nothrow
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
 
-  // nothrow
-  const_reverse_iterator rbegin() const noexcept;
+  // O(1) nothrow
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
 
-  // nothrow
-  const_reverse_iterator rend() const noexcept;
+  // O(h) strong
+  std::pair<iterator, bool> insert(const T& value) {
+    auto [parent, link] = find_insert_position(value);
+    if (!link) {
+      return {iterator(parent), false};
+    }
+    return {iterator(link_node(parent, link, create_node(value))), true};
+  }
 
   // O(h) strong
-  std::pair<iterator, bool> insert(const T&);
+  std::pair<iterator, bool> insert(T&& value) {
+    auto [parent, link] = find_insert_position(value);
+    if (!link) {
+      return {iterator(parent), false};
+    }
+    return {iterator(link_node(parent, link, create_node(std::move(value)))), true};
+  }
+
+  // O(h) strong, a node is created only if the value is absent when called with a single `T`
+  // or, for a transparent comparator, with a single key comparable with `T`
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    if constexpr (sizeof...(Args) == 1 && (std::is_same_v<std::remove_cvref_t<Args>, std::remove_cv_t<T>> && ...)) {
+      return insert(std::forward<Args>(args)...);
+    } else if constexpr (sizeof...(Args) == 1 && (comparable_key<Args> && ...)) {
+      auto [parent, link] = find_insert_position(args...);
+      if (!link) {
+        return {iterator(parent), false};
+      }
+      return {iterator(link_node(parent, link, create_node(std::forward<Args>(args)...))), true};
+    } else {
+      node_base* x = create_node(std::forward<Args>(args)...);
+      std::pair<node_base*, node_base**> position;
+      try {
+        position = find_insert_position(get(x));
+      } catch (...) {
+        destroy_node(x);
+        throw;
+      }
+      if (!position.second) {
+        destroy_node(x);
+        return {iterator(position.first), false};
+      }
+      return {iterator(link_node(position.first, position.second, x)), true};
+    }
+  }
+
+  // amortized O(1) if `value` goes right before `hint`, O(h) otherwise, strong
+  iterator insert(const_iterator hint, const T& value) {
+    auto [parent, link] = find_insert_position(hint, value);
+    if (!link) {
+      return iterator(parent);
+    }
+    return iterator(link_node(parent, link, create_node(value)));
+  }
+
+  // amortized O(1) if `value` goes right before `hint`, O(h) otherwise, strong
+  iterator insert(const_iterator hint, T&& value) {
+    auto [parent, link] = find_insert_position(hint, value);
+    if (!link) {
+      return iterator(parent);
+    }
+    return iterator(link_node(parent, link, create_node(std::move(value))));
+  }
+
+  // amortized O(1) if the value goes right before `hint`, O(h) otherwise, strong
+  template <typename... Args>
+  iterator emplace_hint(const_iterator hint, Args&&... args) {
+    node_base* x = create_node(std::forward<Args>(args)...);
+    std::pair<node_base*, node_base**> position;
+    try {
+      position = find_insert_position(hint, get(x));
+    } catch (...) {
+      destroy_node(x);
+      throw;
+    }
+    if (!position.second) {
+      destroy_node(x);
+      return iterator(position.first);
+    }
+    return iterator(link_node(position.first, position.second, x));
+  }
 
   // O(h) nothrow
-  iterator erase(const_iterator pos);
+  iterator erase(const_iterator pos) {
+    node_base* x = pos.current;
+    node_base* result = set_detail::successor(x);
+    unlink_node(x, result);
+    destroy_node(x);
+    return iterator(result);
+  }
+
+  // O(h) nothrow, the node keeps its value and address
+  node_type extract(const_iterator pos) noexcept {
+    node_base* x = pos.current;
+    unlink_node(x, set_detail::successor(x));
+    reset_links(x);
+    return node_type(x, alloc);
+  }
+
+  // O(h) strong, an empty node if `value` is absent
+  node_type extract(const T& value) {
+    return extract_key(value);
+  }
+
+  // O(h) strong
+  template <typename K>
+  requires set_detail::transparent<Compare> && (!std::is_convertible_v<K&&, const_iterator>)
+  node_type extract(K&& key) {
+    return extract_key(key);
+  }
+
+  // O(h) strong, nothing is allocated; if the value is present the node is returned back in the result
+  insert_return_type insert(node_type&& nh) {
+    if (nh.empty()) {
+      return {end(), false, node_type()};
+    }
+    assert(alloc == *nh.alloc);
+    auto [parent, link] = find_insert_position(get(nh.x));
+    if (!link) {
+      return {iterator(parent), false, std::move(nh)};
+    }
+    return {iterator(link_node(parent, link, nh.release())), true, node_type()};
+  }
+
+  // amortized O(1) if the value goes right before `hint`, O(h) otherwise, strong;
+  // `nh` is left unchanged if the value is present
+  iterator insert(const_iterator hint, node_type&& nh) {
+    if (nh.empty()) {
+      return end();
+    }
+    assert(alloc == *nh.alloc);
+    auto [parent, link] = find_insert_position(hint, get(nh.x));
+    if (!link) {
+      return iterator(parent);
+    }
+    return iterator(link_node(parent, link, nh.release()));
+  }
+
+  // O(m log(n + m)) basic, moves the nodes of `source` whose values are absent in this set without
+  // reallocation, the allocators must be equal
+  void merge(set& source) {
+    assert(alloc == source.alloc);
+    if (&source == this) {
+      return;
+    }
+    for (node_base* x = source.leftmost; x && x != source.end_node();) {
+      node_base* x_next = set_detail::successor(x);
+      auto [parent, link] = find_insert_position(get(x));
+      if (link) {
+        source.unlink_node(x, x_next);
+        reset_links(x);
+        link_node(parent, link, x);
+      }
+      x = x_next;
+    }
+  }
+
+  // O(m log(n + m)) basic
+  void merge(set&& source) {
+    merge(source);
+  }
+
+  // O(h) strong
+  size_t erase(const T& value) {
+    return erase_key(value);
+  }
+
+  // O(h) strong
+  template <typename K>
+  requires set_detail::transparent<Compare> && (!std::is_convertible_v<K&&, const_iterator>)
+  size_t erase(K&& key) {
+    return erase_key(key);
+  }
+
+  // O(h) strong
+  const_iterator lower_bound(const T& value) const {
+    return const_iterator(lower_bound_node(value));
+  }
+
+  // O(h) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator lower_bound(const K& key) const {
+    return const_iterator(lower_bound_node(key));
+  }
 
   // O(h) strong
-  size_t erase(const T&);
+  const_iterator upper_bound(const T& value) const {
+    return const_iterator(upper_bound_node(value));
+  }
 
   // O(h) strong
-  const_iterator lower_bound(const T&) const;
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator upper_bound(const K& key) const {
+    return const_iterator(upper_bound_node(key));
+  }
 
   // O(h) strong
-  const_iterator upper_bound(const T&) const;
+  const_iterator find(const T& value) const {
+    return const_iterator(find_node(value));
+  }
 
   // O(h) strong
-  const_iterator find(const T&) const;
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator find(const K& key) const {
+    return const_iterator(find_node(key));
+  }
+
+  // O(log d) strong for a balanced policy, where d is the distance between `finger` and the result,
+  // same as lower_bound(value); O(h) when the two sit on opposite sides of a high node
+  const_iterator lower_bound_from(const_iterator finger, const T& value) const {
+    return const_iterator(lower_bound_node_from(finger.current, value));
+  }
+
+  // O(log d) strong, same as above
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator lower_bound_from(const_iterator finger, const K& key) const {
+    return const_iterator(lower_bound_node_from(finger.current, key));
+  }
+
+  // O(log d) strong, same as find(value)
+  const_iterator find_from(const_iterator finger, const T& value) const {
+    return const_iterator(find_node_from(finger.current, value));
+  }
+
+  // O(log d) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  const_iterator find_from(const_iterator finger, const K& key) const {
+    return const_iterator(find_node_from(finger.current, key));
+  }
+
+  // O(m h) strong, out[i] = lower_bound(keys[i]) for every key, `out` must be at least as long as `keys`
+  void lower_bound_many(std::span<const T> keys, std::span<const_iterator> out) const {
+    lookup_many(keys, out, false);
+  }
+
+  // O(m h) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  void lower_bound_many(std::span<const K> keys, std::span<const_iterator> out) const {
+    lookup_many(keys, out, false);
+  }
+
+  // O(m h) strong, out[i] = find(keys[i]) for every key, `out` must be at least as long as `keys`
+  void find_many(std::span<const T> keys, std::span<const_iterator> out) const {
+    lookup_many(keys, out, true);
+  }
+
+  // O(m h) strong
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  void find_many(std::span<const K> keys, std::span<const_iterator> out) const {
+    lookup_many(keys, out, true);
+  }
+
+  // O(h) nothrow, end() if k >= size()
+  const_iterator nth(size_t k) const noexcept
+  requires set_detail::counts_subtrees<Policy>
+  {
+    if (k >= count) {
+      return end();
+    }
+    node_base* x = root();
+    for (;;) {
+      size_t left = set_detail::size(x->left);
+      if (k < left) {
+        x = x->left;
+      } else if (k == left) {
+        return const_iterator(x);
+      } else {
+        k -= left + 1;
+        x = x->right;
+      }
+    }
+  }
+
+  // O(h) strong, number of elements less than `value`
+  size_t rank(const T& value) const
+  requires set_detail::counts_subtrees<Policy>
+  {
+    return rank_of_key(value);
+  }
+
+  // O(h) strong
+  template <typename K>
+  requires set_detail::counts_subtrees<Policy> && set_detail::transparent<Compare>
+  size_t rank(const K& key) const {
+    return rank_of_key(key);
+  }
+
+  // O(h) strong, number of elements in [lo, hi)
+  size_t count_in_range(const T& lo, const T& hi) const
+  requires set_detail::counts_subtrees<Policy>
+  {
+    return count_between(lo, hi);
+  }
+
+  // O(h) strong
+  template <typename K>
+  requires set_detail::counts_subtrees<Policy> && set_detail::transparent<Compare>
+  size_t count_in_range(const K& lo, const K& hi) const {
+    return count_between(lo, hi);
+  }
+
+  // O(h) nothrow, position of `pos` in the set, size() for end()
+  size_t index_of(const_iterator pos) const noexcept
+  requires set_detail::counts_subtrees<Policy>
+  {
+    node_base* x = pos.current;
+    if (x == end_node()) {
+      return count;
+    }
+    size_t result = set_detail::size(x->left);
+    for (; !set_detail::is_root(x); x = x->parent) {
+      if (x == x->parent->right) {
+        result += set_detail::size(x->parent->left) + 1;
+      }
+    }
+    return result;
+  }
+
+  // O(h) nothrow, same as std::distance(first, last)
+  difference_type distance(const_iterator first, const_iterator last) const noexcept
+  requires set_detail::counts_subtrees<Policy>
+  {
+    return static_cast<difference_type>(index_of(last)) - static_cast<difference_type>(index_of(first));
+  }
+
+  // O(h) strong with `with_order_statistics`, O(h + min(m, n - m)) strong otherwise, where m is the size of
+  // the first set: without subtree sizes the smaller part has to be counted. Moves the elements less than
+  // `value` to the first set and the others to the second one, this set becomes empty.
+  std::pair<set, set> split(const T& value) {
+    return split_before(lower_bound_node(value));
+  }
+
+  // O(h) strong with `with_order_statistics`, O(h + min(m, n - m)) strong otherwise
+  template <typename K>
+  requires set_detail::transparent<Compare>
+  std::pair<set, set> split(const K& key) {
+    return split_before(lower_bound_node(key));
+  }
+
+  // O(h) strong, every element of `left` must be less than every element of `right`,
+  // both sets become empty and no nodes are allocated or copied
+  friend set join(set&& left, set&& right) {
+    assert(left.alloc == right.alloc);
+    set result(std::move(left));
+    if (right.empty()) {
+      return result;
+    }
+    if (result.empty()) {
+      result.swap_tree(right);
+      return result;
+    }
+    node_base* pivot = result.rightmost;
+    node_base* right_first = right.leftmost;
+    result.unlink_node(pivot, result.end_node());
+    size_t joined_count = result.count + right.count + 1;
+    if constexpr (set_detail::has_links<node_base>) {
+      set_detail::chain(pivot->pred, pivot);
+      set_detail::chain(pivot, right_first);
+    }
+    result.set_root(result.policy.join(result.root(), pivot, right.root()));
+    result.count = joined_count;
+    right.set_root(nullptr);
+    right.count = 0;
+    result.restart_policy();
+    return result;
+  }
+
+  // O(m log(n / m + 1)) basic, where m <= n are the sizes of the sets; the result takes the nodes
+  // of both sets and the nodes of duplicates are destroyed, both sets become empty even on exception;
+  // O(n + m) with in-order links
+  friend set set_union(set&& lhs, set&& rhs) {
+    return combine_sets<set_detail::set_operation::union_>(lhs, rhs, 1);
+  }
+
+  // O(m log(n / m + 1)) basic, same as above but large inputs are processed on several threads
+  friend set set_union(parallel_t, set&& lhs, set&& rhs) {
+    return combine_sets<set_detail::set_operation::union_>(lhs, rhs, hardware_threads());
+  }
+
+  // O(m log(n / m + 1)) basic, the result keeps the nodes of `lhs` that have an equal element in `rhs`
+  friend set set_intersection(set&& lhs, set&& rhs) {
+    return combine_sets<set_detail::set_operation::intersection>(lhs, rhs, 1);
+  }
+
+  // O(m log(n / m + 1)) basic
+  friend set set_intersection(parallel_t, set&& lhs, set&& rhs) {
+    return combine_sets<set_detail::set_operation::intersection>(lhs, rhs, hardware_threads());
+  }
+
+  // O(m log(n / m + 1)) basic, the result keeps the nodes of `lhs` that have no equal element in `rhs`
+  friend set set_difference(set&& lhs, set&& rhs) {
+    return combine_sets<set_detail::set_operation::difference>(lhs, rhs, 1);
+  }
+
+  // O(m log(n / m + 1)) basic
+  friend set set_difference(parallel_t, set&& lhs, set&& rhs) {
+    return combine_sets<set_detail::set_operation::difference>(lhs, rhs, hardware_threads());
+  }
 
   // O(1) nothrow
-  friend void swap(set&, set&) noexcept;
+  friend void swap(set& lhs, set& rhs) noexcept(std::is_nothrow_swappable_v<Compare>) {
+    if constexpr (node_traits::propagate_on_container_swap::value) {
+      using std::swap;
+      swap(lhs.alloc, rhs.alloc);
+    } else {
+      assert(lhs.alloc == rhs.alloc);
+    }
+    lhs.swap_contents(rhs);
+  }
+
+private:
+  static const T& get(const node_base* x) noexcept {
+    return static_cast<const node*>(x)->value;
+  }
+
+  node_base* end_node() const noexcept {
+    return const_cast<node_base*>(&sentinel);
+  }
+
+  node_base* root() const noexcept {
+    return sentinel.left;
+  }
+
+  // In-order links between the nodes are left as they are.
+  void set_root(node_base* x) noexcept {
+    sentinel.left = x;
+    adopt_root();
+    leftmost = x ? set_detail::minimum(x) : nullptr;
+    rightmost = x ? set_detail::maximum(x) : nullptr;
+    adopt_ends();
+  }
+
+  void adopt_root() noexcept {
+    if (sentinel.left) {
+      sentinel.left->parent = &sentinel;
+    }
+  }
+
+  // Closes the cycle of in-order links through the sentinel.
+  void adopt_ends() noexcept {
+    if (leftmost) {
+      set_detail::chain(end_node(), leftmost);
+      set_detail::chain(rightmost, end_node());
+    } else {
+      set_detail::chain(end_node(), end_node());
+    }
+  }
+
+  // Rebuilds all in-order links from the tree shape in O(n).
+  void thread_nodes() noexcept {
+    if constexpr (set_detail::has_links<node_base>) {
+      node_base* last = end_node();
+      for (node_base* x = leftmost; x; x = x == rightmost ? nullptr : set_detail::next(x)) {
+        set_detail::chain(last, x);
+        last = x;
+      }
+      set_detail::chain(last, end_node());
+    }
+  }
+
+  void swap_contents(set& other) noexcept(std::is_nothrow_swappable_v<Compare>) {
+    using std::swap;
+    swap(comp, other.comp);
+    swap_tree(other);
+  }
+
+  void swap_tree(set& other) noexcept {
+    using std::swap;
+    swap(sentinel.left, other.sentinel.left);
+    swap(leftmost, other.leftmost);
+    swap(rightmost, other.rightmost);
+    swap(count, other.count);
+    swap(policy, other.policy);
+    adopt_root();
+    other.adopt_root();
+    adopt_ends();
+    other.adopt_ends();
+  }
+
+  // Lets a policy that balances by node count start over after the tree was restructured as a whole.
+  void restart_policy() noexcept {
+    if constexpr (set_detail::balances_by_count<Policy>) {
+      policy.restart(count);
+    }
+  }
+
+  static size_t hardware_threads() noexcept {
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  template <set_detail::set_operation Op>
+  static set combine_sets(set& lhs, set& rhs, size_t threads) {
+    assert(lhs.alloc == rhs.alloc);
+    set result(lhs.comp, Allocator(lhs.alloc));
+    result.policy = lhs.policy;
+    size_t lhs_count = lhs.count;
+    size_t total_count = lhs.count + rhs.count;
+    node_base* a = lhs.root();
+    node_base* b = rhs.root();
+    lhs.set_root(nullptr);
+    lhs.count = 0;
+    rhs.set_root(nullptr);
+    rhs.count = 0;
+
+    auto [root, matches] = result.combine<Op>(a, b, threads, total_count);
+    result.set_root(root);
+    result.thread_nodes();
+    if constexpr (Op == set_detail::set_operation::union_) {
+      result.count = total_count - matches;
+    } else if constexpr (Op == set_detail::set_operation::intersection) {
+      result.count = matches;
+    } else {
+      result.count = lhs_count - matches;
+    }
+    result.restart_policy();
+    return result;
+  }
+
+  // Combines detached trees `a` and `b` by splitting `b` around the root of `a` and recursing on both sides,
+  // returns the new root and the number of elements found in both trees.
+  // The trees are consumed even on exception. Up to `threads` threads are used while `elements` is large.
+  template <set_detail::set_operation Op>
+  std::pair<node_base*, size_t> combine(node_base* a, node_base* b, size_t threads, size_t elements) {
+    using enum set_detail::set_operation;
+    if (!a || !b) {
+      node_base* kept = Op == union_ ? (a ? a : b) : Op == difference ? a : nullptr;
+      destroy(kept == a ? b : a);
+      return {kept, 0};
+    }
+
+    node_base* k = a;
+    node_base* a_left = a->left;
+    node_base* a_right = a->right;
+    node_base* b_left;
+    node_base* duplicate;
+    node_base* b_right;
+    try {
+      std::tie(b_left, duplicate, b_right) = split_tree(b, get(k));
+    } catch (...) {
+      destroy(a);
+      destroy(b);
+      throw;
+    }
+
+    auto cleanup = [&](node_base* tree) noexcept {
+      destroy(tree);
+      destroy_node(k);
+      if (duplicate) {
+        destroy_node(duplicate);
+      }
+    };
+
+    std::pair<node_base*, size_t> left;
+    std::pair<node_base*, size_t> right;
+    bool forked = false;
+    if (threads > 1 && elements >= set_detail::parallel_grain) {
+      std::future<std::pair<node_base*, size_t>> left_future;
+      try {
+        left_future = std::async(std::launch::async, [&] {
+          return combine<Op>(a_left, b_left, threads / 2, elements / 2);
+        });
+        forked = true;
+      } catch (...) {}
+      if (forked) {
+        try {
+          right = combine<Op>(a_right, b_right, threads - threads / 2, elements / 2);
+        } catch (...) {
+          try {
+            cleanup(left_future.get().first);
+          } catch (...) {
+            cleanup(nullptr);
+          }
+          throw;
+        }
+        try {
+          left = left_future.get();
+        } catch (...) {
+          cleanup(right.first);
+          throw;
+        }
+      }
+    }
+    if (!forked) {
+      try {
+        left = combine<Op>(a_left, b_left, 1, 0);
+      } catch (...) {
+        destroy(a_right);
+        destroy(b_right);
+        cleanup(nullptr);
+        throw;
+      }
+      try {
+        right = combine<Op>(a_right, b_right, 1, 0);
+      } catch (...) {
+        cleanup(left.first);
+        throw;
+      }
+    }
+
+    size_t matches = left.second + right.second + (duplicate != nullptr);
+    if (duplicate) {
+      destroy_node(duplicate);
+    }
+    bool keep_k = Op == union_ || (Op == intersection) == (duplicate != nullptr);
+    if (keep_k) {
+      return {policy.join(left.first, k, right.first), matches};
+    }
+    destroy_node(k);
+    return {join_trees(left.first, right.first), matches};
+  }
+
+  // Splits detached tree `t` into the nodes less than `key`, the node equal to `key` and the nodes greater than `key`.
+  // On exception `t` is left intact.
+  template <typename K>
+  std::tuple<node_base*, node_base*, node_base*> split_tree(node_base* t, const K& key) {
+    node_base* p = nullptr;
+    for (node_base* x = t; x;) {
+      if (comp(get(x), key)) {
+        x = x->right;
+      } else {
+        p = x;
+        x = x->left;
+      }
+    }
+    if (!p) {
+      return {t, nullptr, nullptr};
+    }
+    bool found = !comp(key, get(p));
+
+    node_base header;
+    header.left = t;
+    t->parent = &header;
+    auto [less, rest] = policy.split(p);
+    if (!found) {
+      return {less, nullptr, rest};
+    }
+    header.left = rest;
+    rest->parent = &header;
+    policy.erase(p);
+    return {less, p, header.left};
+  }
+
+  // Joins detached trees `l` < `r` using the minimum of `r` as the middle node.
+  node_base* join_trees(node_base* l, node_base* r) noexcept {
+    if (!l || !r) {
+      return l ? l : r;
+    }
+    node_base header;
+    header.left = r;
+    r->parent = &header;
+    node_base* middle = set_detail::minimum(r);
+    policy.erase(middle);
+    return policy.join(l, middle, header.left);
+  }
+
+  // Removes `x` from the tree without destroying it, `x_next` is the node after `x`.
+  void unlink_node(node_base* x, node_base* x_next) noexcept {
+    if (x == rightmost) {
+      rightmost = x == leftmost ? nullptr : set_detail::predecessor(x);
+    }
+    if (x == leftmost) {
+      leftmost = x_next == end_node() ? nullptr : x_next;
+    }
+    if constexpr (set_detail::has_links<node_base>) {
+      set_detail::chain(x->pred, x_next);
+    }
+    policy.erase(x);
+    --count;
+    if constexpr (set_detail::balances_by_count<Policy>) {
+      policy.after_erase(root(), count);
+    }
+  }
+
+  // Returns an unlinked node to the state of a newly created one.
+  static void reset_links(node_base* x) noexcept {
+    *x = node_base();
+  }
+
+  // Number of nodes before `x`, O(h) with order statistics and O(min(m, n - m)) otherwise.
+  size_t count_before(node_base* x) const noexcept {
+    if constexpr (set_detail::counts_subtrees<Policy>) {
+      return index_of(const_iterator(x));
+    } else {
+      node_base* from_begin = leftmost;
+      node_base* from_x = x;
+      for (size_t steps = 0;; ++steps) {
+        if (from_begin == x) {
+          return steps;
+        }
+        if (from_x == end_node()) {
+          return count - steps;
+        }
+        from_begin = set_detail::successor(from_begin);
+        from_x = set_detail::successor(from_x);
+      }
+    }
+  }
+
+  std::pair<set, set> split_before(node_base* p) {
+    std::pair<set, set> result(set(comp, Allocator(alloc)), set(comp, Allocator(alloc)));
+    if (p == end_node()) {
+      result.first.swap_tree(*this);
+    } else if (p == leftmost) {
+      result.second.swap_tree(*this);
+    } else {
+      size_t left_count = count_before(p);
+      auto [left, right] = policy.split(p);
+      result.first.policy = policy;
+      result.second.policy = policy;
+      result.first.set_root(left);
+      result.first.count = left_count;
+      result.second.set_root(right);
+      result.second.count = count - left_count;
+      set_root(nullptr);
+      count = 0;
+    }
+    result.first.restart_policy();
+    result.second.restart_policy();
+    return result;
+  }
+
+  template <typename... Args>
+  node_base* create_node(Args&&... args) {
+    node* x = std::to_address(node_traits::allocate(alloc, 1));
+    ::new (static_cast<void*>(x)) node;
+    try {
+      node_traits::construct(alloc, std::addressof(x->value), std::forward<Args>(args)...);
+    } catch (...) {
+      x->~node();
+      node_traits::deallocate(alloc, x, 1);
+      throw;
+    }
+    return x;
+  }
+
+  void destroy_node(node_base* x) noexcept {
+    destroy_node(alloc, x);
+  }
+
+  static void destroy_node(node_allocator& alloc, node_base* x) noexcept {
+    node* n = static_cast<node*>(x);
+    node_traits::destroy(alloc, std::addressof(n->value));
+    n->~node();
+    node_traits::deallocate(alloc, n, 1);
+  }
+
+  // Searches the subtree of `x`, `result` is returned if no value in it is at least `key`.
+  template <typename K>
+  node_base* lower_bound_node(const K& key, node_base* x, node_base* result) const {
+    node_base* last = nullptr;
+    while (x) {
+      last = x;
+      if (comp(get(x), key)) {
+        x = x->right;
+      } else {
+        result = x;
+        if constexpr (set_detail::adjusts_on_access<Policy>) {
+          // Stopping at an equal value keeps the search path, and thus the restructuring, short.
+          if (!comp(key, get(x))) {
+            break;
+          }
+        }
+        x = x->left;
+      }
+    }
+    accessed(last, result);
+    return result;
+  }
+
+  template <typename K>
+  node_base* lower_bound_node(const K& key) const {
+    return lower_bound_node(key, root(), end_node());
+  }
+
+  // Climbs from `finger` to the lowest ancestor `x` whose subtree, together with the node after it, holds the lower
+  // bound of `key`, and descends from there. Every node on the way up is on the same side of `key` as `finger`
+  // or has been compared already, so `x` itself needs no comparison.
+  template <typename K>
+  node_base* lower_bound_node_from(node_base* finger, const K& key) const {
+    if (finger == end_node()) {
+      if (!rightmost || comp(get(rightmost), key)) {
+        return end_node();
+      }
+      finger = rightmost;
+    }
+
+    node_base* x = finger;
+    if (comp(get(finger), key)) {
+      for (; !set_detail::is_root(x); x = x->parent) {
+        if (x == x->parent->left && !comp(get(x->parent), key)) {
+          return lower_bound_node(key, x->right, x->parent);
+        }
+      }
+      return lower_bound_node(key, x->right, end_node());
+    }
+
+    while (!set_detail::is_root(x) && !(x == x->parent->right && comp(get(x->parent), key))) {
+      x = x->parent;
+    }
+    return lower_bound_node(key, x->left, x);
+  }
+
+  template <typename K>
+  node_base* upper_bound_node(const K& key) const {
+    node_base* result = end_node();
+    node_base* last = nullptr;
+    for (node_base* x = root(); x;) {
+      last = x;
+      if (comp(key, get(x))) {
+        result = x;
+        x = x->left;
+      } else {
+        x = x->right;
+      }
+    }
+    accessed(last, result);
+    return result;
+  }
+
+  // Lets a self-adjusting policy restructure the tree after a lookup that ended at `last` and found `result`.
+  // The whole search path is adjusted first, then the found node is brought to the top.
+  void accessed([[maybe_unused]] node_base* last, [[maybe_unused]] node_base* result) const noexcept {
+    if constexpr (set_detail::adjusts_on_access<Policy>) {
+      if (last) {
+        Policy::after_access(last);
+      }
+      if (result != last && result != end_node()) {
+        Policy::after_access(result);
+      }
+    }
+  }
+
+  template <typename K>
+  node_base* find_node(const K& key) const {
+    node_base* x = lower_bound_node(key);
+    if (x == end_node() || comp(key, get(x))) {
+      return end_node();
+    }
+    return x;
+  }
+
+  template <typename K>
+  node_base* find_node_from(node_base* finger, const K& key) const {
+    node_base* x = lower_bound_node_from(finger, key);
+    if (x == end_node() || comp(key, get(x))) {
+      return end_node();
+    }
+    return x;
+  }
+
+  // Descends a group of lookups one level at a time, prefetching the next node of each,
+  // so that their cache misses overlap instead of being paid one after another.
+  template <typename K>
+  void lookup_many(std::span<const K> keys, std::span<const_iterator> out, bool exact) const {
+    assert(out.size() >= keys.size());
+    constexpr size_t group = set_detail::lookup_group;
+    node_base* cursor[group];
+    node_base* result[group];
+    for (size_t first = 0; first < keys.size(); first += group) {
+      size_t m = std::min(group, keys.size() - first);
+      const K* key = keys.data() + first;
+      for (size_t i = 0; i < m; ++i) {
+        cursor[i] = root();
+        result[i] = end_node();
+      }
+      for (bool active = root() != nullptr; active;) {
+        active = false;
+        for (size_t i = 0; i < m; ++i) {
+          node_base* x = cursor[i];
+          if (!x) {
+            continue;
+          }
+          if (comp(get(x), key[i])) {
+            x = x->right;
+          } else {
+            result[i] = x;
+            x = x->left;
+          }
+          cursor[i] = x;
+          if (x) {
+            set_detail::prefetch(x);
+            active = true;
+          }
+        }
+      }
+      for (size_t i = 0; i < m; ++i) {
+        if (exact && result[i] != end_node() && comp(key[i], get(result[i]))) {
+          result[i] = end_node();
+        }
+        out[first + i] = const_iterator(result[i]);
+      }
+    }
+  }
+
+  template <typename K>
+  size_t erase_key(const K& key) {
+    node_base* x = find_node(key);
+    if (x == end_node()) {
+      return 0;
+    }
+    erase(const_iterator(x));
+    return 1;
+  }
+
+  template <typename K>
+  node_type extract_key(const K& key) {
+    node_base* x = find_node(key);
+    if (x == end_node()) {
+      return node_type();
+    }
+    return extract(const_iterator(x));
+  }
+
+  template <typename K>
+  size_t rank_of_key(const K& key) const {
+    size_t result = 0;
+    for (node_base* x = root(); x;) {
+      if (comp(get(x), key)) {
+        result += set_detail::size(x->left) + 1;
+        x = x->right;
+      } else {
+        x = x->left;
+      }
+    }
+    return result;
+  }
+
+  template <typename K>
+  size_t count_between(const K& lo, const K& hi) const {
+    size_t lo_rank = rank_of_key(lo);
+    size_t hi_rank = rank_of_key(hi);
+    return hi_rank > lo_rank ? hi_rank - lo_rank : 0;
+  }
+
+  // Returns the parent and the empty link where `value` belongs, or the node equal to `value` and null.
+  template <typename K>
+  std::pair<node_base*, node_base**> find_insert_position(const K& value) const {
+    node_base* parent = end_node();
+    node_base** link = &end_node()->left;
+    while (*link) {
+      parent = *link;
+      if (comp(value, get(parent))) {
+        link = &parent->left;
+      } else if (comp(get(parent), value)) {
+        link = &parent->right;
+      } else {
+        return {parent, nullptr};
+      }
+    }
+    return {parent, link};
+  }
+
+  // Same as above, but takes O(1) comparisons if `value` belongs right before or right after `hint`.
+  std::pair<node_base*, node_base**> find_insert_position(const_iterator hint, const T& value) const {
+    node_base* x = hint.current;
+    if (x == end_node()) {
+      if (rightmost && comp(get(rightmost), value)) {
+        return {rightmost, &rightmost->right};
+      }
+      return find_insert_position(value);
+    }
+
+    // The neighbours come from the policy-aware steps, which are O(1) with in-order links.
+    if (comp(value, get(x))) {
+      node_base* before = x == leftmost ? nullptr : set_detail::predecessor(x);
+      if (!before || comp(get(before), value)) {
+        return x->left ? std::pair{before, &before->right} : std::pair{x, &x->left};
+      }
+      return find_insert_position(value);
+    }
+
+    if (comp(get(x), value)) {
+      node_base* after = x == rightmost ? nullptr : set_detail::successor(x);
+      if (!after || comp(value, get(after))) {
+        return x->right ? std::pair{after, &after->left} : std::pair{x, &x->right};
+      }
+      return find_insert_position(value);
+    }
+
+    return {x, nullptr};
+  }
+
+  node_base* link_node(node_base* parent, node_base** link, node_base* x) noexcept {
+    set_detail::increment_sizes(parent);
+    if (parent == end_node()) {
+      leftmost = x;
+      rightmost = x;
+    } else if (parent == leftmost && link == &parent->left) {
+      leftmost = x;
+    } else if (parent == rightmost && link == &parent->right) {
+      rightmost = x;
+    }
+    x->parent = parent;
+    *link = x;
+    ++count;
+    if constexpr (set_detail::has_links<node_base>) {
+      if (parent == end_node()) {
+        set_detail::chain(end_node(), x);
+        set_detail::chain(x, end_node());
+      } else if (link == &parent->left) {
+        set_detail::chain(parent->pred, x);
+        set_detail::chain(x, parent);
+      } else {
+        set_detail::chain(x, parent->succ);
+        set_detail::chain(parent, x);
+      }
+    }
+    if constexpr (set_detail::balances_by_count<Policy>) {
+      policy.after_insert(x, count);
+    } else {
+      policy.after_insert(x);
+    }
+    return x;
+  }
+
+  // Moves all values of `other` into new nodes of this (empty) set and clears `other`.
+  void move_from(set& other) {
+    if (other.root()) {
+      set_root(clone<true>(other.root()));
+      count = other.count;
+      policy = other.policy;
+      thread_nodes();
+    }
+    other.clear();
+  }
+
+  template <bool Move = false>
+  node_base* clone(node_base* x) {
+    if constexpr (Move) {
+      return clone(x, [this](node_base* y) { return create_node(std::move(static_cast<node*>(y)->value)); });
+    } else {
+      return clone(x, [this](node_base* y) { return create_node(get(y)); });
+    }
+  }
+
+  // Copies the shape of the tree rooted at `x`, `make` returns a detached node holding the value of the given one.
+  // O(n) without comparisons; walks both trees through parent pointers, so the stack stays O(1) for any shape.
+  template <typename Make>
+  node_base* clone(node_base* x, const Make& make) {
+    node_base* result = make(x);
+    result->data = x->data;
+    node_base* from = x;
+    node_base* to = result;
+    try {
+      for (;;) {
+        if (from->left && !to->left) {
+          from = from->left;
+          to->left = make(from);
+          to->left->parent = to;
+          to = to->left;
+        } else if (from->right && !to->right) {
+          from = from->right;
+          to->right = make(from);
+          to->right->parent = to;
+          to = to->right;
+        } else {
+          set_detail::update_size(to);
+          if (from == x) {
+            break;
+          }
+          from = from->parent;
+          to = to->parent;
+          continue;
+        }
+        to->data = from->data;
+      }
+    } catch (...) {
+      destroy(result);
+      throw;
+    }
+    return result;
+  }
+
+  static constexpr bool recycles_nodes =
+      std::is_nothrow_copy_assignable_v<T> && std::is_nothrow_copy_assignable_v<Compare>;
+
+  // Copy assignment that keeps the nodes of this set. The missing nodes are created before anything is
+  // changed, so the rest cannot throw and the strong guarantee holds.
+  void assign_recycled(const set& other) {
+    node_base* spare = nullptr;
+    try {
+      for (size_t i = count; i < other.count; ++i) {
+        node_base* x = create_node(get(other.root()));
+        x->left = spare;
+        spare = x;
+      }
+    } catch (...) {
+      destroy(spare);
+      throw;
+    }
+
+    spare = unravel(root(), spare);
+    node_base* copy = nullptr;
+    if (other.root()) {
+      copy = clone(other.root(), [&spare](node_base* y) noexcept -> node_base* {
+        node* x = static_cast<node*>(spare);
+        spare = spare->left;
+        x->left = nullptr;
+        x->right = nullptr;
+        x->value = get(y);
+        return x;
+      });
+    }
+    destroy(spare);
+
+    comp = other.comp;
+    if constexpr (node_traits::propagate_on_container_copy_assignment::value) {
+      alloc = other.alloc;
+    }
+    policy = other.policy;
+    set_root(copy);
+    count = other.count;
+    thread_nodes();
+  }
+
+  // Dismantles the tree rooted at `x` into a list linked through `left` and puts it in front of `list`,
+  // O(n) time and O(1) space.
+  static node_base* unravel(node_base* x, node_base* list) noexcept {
+    while (x) {
+      if (node_base* y = x->right) {
+        x->right = y->left;
+        y->left = x;
+        x = y;
+      } else {
+        node_base* next = x->left;
+        x->left = list;
+        list = x;
+        x = next;
+      }
+    }
+    return list;
+  }
+
+  // Sorted input is built in O(n), runs of equivalent values in it are skipped; strictly increasing input
+  // costs one comparison per value.
+  template <typename InputIt>
+  void insert_range(InputIt first, InputIt last) {
+    if constexpr (std::forward_iterator<InputIt>) {
+      size_t n = 0;
+      size_t distinct = 0;
+      bool sorted = true;
+      if (first != last) {
+        n = distinct = 1;
+        for (InputIt prev = first, it = std::next(first); it != last; prev = it, ++it, ++n) {
+          if (comp(*prev, *it)) {
+            ++distinct;
+          } else if (comp(*it, *prev)) {
+            sorted = false;
+            break;
+          }
+        }
+      }
+      if (sorted) {
+        if (distinct == n) {
+          build_sorted(first, n);
+        } else {
+          build_sorted(set_detail::distinct_iterator<InputIt, Compare>{first, last, &comp}, distinct);
+        }
+        return;
+      }
+    }
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  // Builds a tree of minimal height from `n` sorted unique values, the set must be empty.
+  template <typename It>
+  void build_sorted(It first, size_t n) {
+    assert(empty());
+    if (n != 0) {
+      set_root(build_sorted(first, n, 0, std::bit_width(n) - 1));
+      count = n;
+      thread_nodes();
+    }
+  }
+
+  template <typename It>
+  node_base* build_sorted(It& it, size_t n, size_t depth, size_t max_depth) {
+    if (n == 0) {
+      return nullptr;
+    }
+    size_t left_size = (n - 1) / 2;
+    node_base* left = build_sorted(it, left_size, depth + 1, max_depth);
+
+    node_base* x;
+    try {
+      x = create_node(*it);
+      ++it;
+    } catch (...) {
+      destroy(left);
+      throw;
+    }
+    x->left = left;
+    if (left) {
+      left->parent = x;
+    }
+
+    try {
+      x->right = build_sorted(it, n - 1 - left_size, depth + 1, max_depth);
+    } catch (...) {
+      destroy(x);
+      throw;
+    }
+    if (x->right) {
+      x->right->parent = x;
+    }
+
+    set_detail::update_size(x);
+    policy.after_build(x, depth, max_depth);
+    return x;
+  }
+
+  // Destroys the tree rooted at `x` in O(n) time and O(1) space: right subtrees are rotated onto the left spine
+  // as it is consumed, so degenerate trees need no stack.
+  void destroy(node_base* x) noexcept {
+    node* batch[set_detail::free_batch];
+    size_t n = 0;
+    while (x) {
+      if (node_base* y = x->right) {
+        x->right = y->left;
+        y->left = x;
+        x = y;
+      } else {
+        node* dead = static_cast<node*>(x);
+        x = x->left;
+        node_traits::destroy(alloc, std::addressof(dead->value));
+        batch[n++] = dead;
+        if (n == set_detail::free_batch) {
+          free_nodes(batch, n);
+          n = 0;
+        }
+      }
+    }
+    free_nodes(batch, n);
+  }
+
+  // Allocators with `deallocate_bulk` (such as `pool_allocator`) take the whole batch back in one call.
+  void free_nodes(node* const* batch, size_t n) noexcept {
+    for (size_t i = 0; i < n; ++i) {
+      batch[i]->~node();
+    }
+    if constexpr (set_detail::deallocates_in_bulk<node_allocator, node>) {
+      alloc.deallocate_bulk(batch, n);
+    } else {
+      for (size_t i = 0; i < n; ++i) {
+        node_traits::deallocate(alloc, batch[i], 1);
+      }
+    }
+  }
+
+private:
+  node_base sentinel;
+  node_base* leftmost = nullptr;
+  node_base* rightmost = nullptr;
+  size_t count = 0;
+  [[no_unique_address]] Compare comp{};
+  [[no_unique_address]] node_allocator alloc{};
+  [[no_unique_address]] Policy policy;
 };
@@ -0,0 +1,396 @@
+#include "btree-set.h"
+#include "fault-injection.h"
+#include "pool-allocator.h"
+#include "set.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+template class btree_set<int>;
+template class btree_set<std::string>;
+template class btree_set<int, std::less<>>;
+template class btree_set<int, std::less<int>, pool_allocator<int>>;
+
+namespace {
+
+using small_btree = btree_set<int, std::less<int>, std::allocator<int>, 16>;
+
+static_assert(small_btree::node_capacity == 3);
+
+struct faulty_less {
+  bool operator()(int a, int b) const {
+    fault_injection_point();
+    return a < b;
+  }
+};
+
+using faulty_btree = btree_set<int, faulty_less, std::allocator<int>, 16>;
+
+class btree_correctness_test : public base_test {};
+
+class btree_exception_safety_test : public base_test {};
+
+class btree_performance_test : public base_test {};
+
+class btree_random_test : public base_test {};
+
+} // namespace
+
+TEST_F(btree_correctness_test, default_ctor) {
+  btree_set<int> c;
+  expect_empty(c);
+}
+
+TEST_F(btree_correctness_test, insert) {
+  small_btree c;
+  for (int i : {5, 2, 8, 1, 9, 3, 7, 4, 6, 0}) {
+    auto [it, inserted] = c.insert(i);
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(i, *it);
+  }
+  auto [it, inserted] = c.insert(5);
+  EXPECT_FALSE(inserted);
+  EXPECT_EQ(5, *it);
+  expect_eq(c, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+  expect_eq(reverse_view(c), {9, 8, 7, 6, 5, 4, 3, 2, 1, 0});
+}
+
+TEST_F(btree_correctness_test, emplace) {
+  btree_set<std::string> c;
+  c.emplace(3, 'a');
+  c.emplace("b");
+  c.emplace_hint(c.end(), "c");
+  auto [it, inserted] = c.emplace("aaa");
+  EXPECT_FALSE(inserted);
+  EXPECT_EQ("aaa", *it);
+  expect_eq(c, std::vector<std::string>{"aaa", "b", "c"});
+}
+
+TEST_F(btree_correctness_test, insert_hint) {
+  small_btree c;
+  for (int i = 0; i < 100; i += 2) {
+    c.insert(c.end(), i);
+  }
+  for (int i = 1; i < 100; i += 2) {
+    auto it = c.insert(c.find(i + 1), i);
+    EXPECT_EQ(i, *it);
+  }
+  auto it = c.insert(c.begin(), 50);
+  EXPECT_EQ(50, *it);
+  EXPECT_EQ(100, c.size());
+  std::vector<int> expected(100);
+  std::iota(expected.begin(), expected.end(), 0);
+  expect_eq(c, expected);
+}
+
+TEST_F(btree_correctness_test, find) {
+  small_btree c;
+  for (int i = 0; i < 50; ++i) {
+    c.insert(i * 2);
+  }
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(i * 2, *c.find(i * 2));
+    EXPECT_EQ(c.end(), c.find(i * 2 + 1));
+  }
+  EXPECT_EQ(c.end(), c.find(-1));
+}
+
+TEST_F(btree_correctness_test, bounds) {
+  small_btree c;
+  for (int i = 0; i < 50; ++i) {
+    c.insert(i * 2);
+  }
+  for (int i = -1; i < 100; ++i) {
+    int lower = i <= 0 ? 0 : (i + 1) / 2 * 2;
+    int upper = i < 0 ? 0 : i / 2 * 2 + 2;
+    if (lower < 100) {
+      EXPECT_EQ(lower, *c.lower_bound(i));
+    } else {
+      EXPECT_EQ(c.end(), c.lower_bound(i));
+    }
+    if (upper < 100) {
+      EXPECT_EQ(upper, *c.upper_bound(i));
+    } else {
+      EXPECT_EQ(c.end(), c.upper_bound(i));
+    }
+  }
+}
+
+TEST_F(btree_correctness_test, erase) {
+  small_btree c;
+  for (int i = 0; i < 100; ++i) {
+    c.insert(i);
+  }
+  for (int i = 0; i < 100; i += 3) {
+    EXPECT_EQ(1, c.erase(i));
+    EXPECT_EQ(0, c.erase(i));
+  }
+  std::vector<int> expected;
+  for (int i = 0; i < 100; ++i) {
+    if (i % 3 != 0) {
+      expected.push_back(i);
+    }
+  }
+  expect_eq(c, expected);
+}
+
+TEST_F(btree_correctness_test, erase_iterator) {
+  small_btree c;
+  for (int i = 0; i < 200; ++i) {
+    c.insert(i);
+  }
+  for (auto it = c.begin(); it != c.end();) {
+    int value = *it;
+    it = c.erase(it);
+    if (it != c.end()) {
+      EXPECT_EQ(value + 1, *it);
+      ++it;
+    }
+  }
+  EXPECT_EQ(100, c.size());
+  for (auto it = c.begin(); it != c.end();) {
+    it = c.erase(it);
+  }
+  expect_empty(c);
+}
+
+TEST_F(btree_correctness_test, erase_last) {
+  small_btree c;
+  for (int i = 0; i < 50; ++i) {
+    c.insert(i);
+  }
+  while (!c.empty()) {
+    EXPECT_EQ(c.end(), c.erase(std::prev(c.end())));
+  }
+}
+
+TEST_F(btree_correctness_test, range_ctor) {
+  std::vector<int> v = {5, 3, 8, 1, 3, 9};
+  btree_set<int> c(v.begin(), v.end());
+  expect_eq(c, {1, 3, 5, 8, 9});
+
+  std::vector<int> sorted(1000);
+  std::iota(sorted.begin(), sorted.end(), 0);
+  small_btree c2(sorted_unique, sorted.begin(), sorted.end());
+  expect_eq(c2, sorted);
+
+  c2.assign(v.begin(), v.end());
+  expect_eq(c2, {1, 3, 5, 8, 9});
+}
+
+TEST_F(btree_correctness_test, copy_move) {
+  small_btree c;
+  for (int i = 0; i < 100; ++i) {
+    c.insert(i);
+  }
+
+  small_btree c2 = c;
+  c2.erase(50);
+  EXPECT_EQ(100, c.size());
+  EXPECT_EQ(99, c2.size());
+
+  small_btree c3 = std::move(c2);
+  expect_empty(c2);
+  EXPECT_EQ(99, c3.size());
+
+  c2 = c3;
+  c3 = std::move(c);
+  EXPECT_EQ(99, c2.size());
+  EXPECT_EQ(100, c3.size());
+  expect_empty(c);
+
+  swap(c2, c3);
+  EXPECT_EQ(100, c2.size());
+  EXPECT_EQ(c3.end(), c3.find(50));
+}
+
+TEST_F(btree_correctness_test, transparent_lookup) {
+  btree_set<int, std::less<>> c;
+  c.insert(1);
+  c.insert(3);
+  long key = 3;
+  EXPECT_EQ(3, *c.find(key));
+  EXPECT_EQ(3, *c.lower_bound(2L));
+  EXPECT_EQ(1, c.erase(key));
+}
+
+TEST_F(btree_correctness_test, pool_allocator) {
+  node_pool pool;
+  btree_set<int, std::less<int>, pool_allocator<int>> c{pool_allocator<int>(pool)};
+  for (int i = 0; i < 1000; ++i) {
+    c.insert(i);
+  }
+  auto c2 = c;
+  for (int i = 0; i < 1000; i += 2) {
+    c.erase(i);
+  }
+  EXPECT_EQ(500, c.size());
+  EXPECT_EQ(1000, c2.size());
+}
+
+TEST_F(btree_exception_safety_test, insert) {
+  faulty_run([] {
+    faulty_btree c;
+    {
+      fault_injection_disable dg;
+      for (int i = 0; i < 40; i += 2) {
+        c.insert(i);
+      }
+    }
+    strong_exception_safety_guard sg(c);
+    c.insert(17);
+  });
+}
+
+TEST_F(btree_exception_safety_test, copy) {
+  faulty_run([] {
+    faulty_btree c;
+    {
+      fault_injection_disable dg;
+      for (int i = 0; i < 40; ++i) {
+        c.insert(i);
+      }
+    }
+    strong_exception_safety_guard sg(c);
+    faulty_btree c2 = c;
+    c2.erase(5);
+    c = c2;
+  });
+}
+
+TEST_F(btree_exception_safety_test, erase) {
+  faulty_run([] {
+    faulty_btree c;
+    {
+      fault_injection_disable dg;
+      for (int i = 0; i < 40; ++i) {
+        c.insert(i);
+      }
+    }
+    strong_exception_safety_guard sg(c);
+    c.erase(17);
+  });
+}
+
+TEST_F(btree_performance_test, lower_bound_vs_set) {
+  constexpr int n = 1'000'000;
+  std::vector<int> values(n);
+  std::iota(values.begin(), values.end(), 0);
+  std::vector<int> keys(n);
+  std::mt19937 rng(42);
+  std::uniform_int_distribution key_dist(0, 2 * n);
+  std::generate(keys.begin(), keys.end(), [&] { return key_dist(rng); });
+
+  set<int> tree(sorted_unique, values.begin(), values.end());
+  btree_set<int> btree(sorted_unique, values.begin(), values.end());
+
+  auto us = [](std::chrono::steady_clock::duration duration) {
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+  };
+
+  auto lookup_time = [&](const auto& c) {
+    auto start = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for (int key : keys) {
+      found += c.lower_bound(key) != c.end();
+    }
+    EXPECT_EQ(std::count_if(keys.begin(), keys.end(), [](int key) { return key < n; }), found);
+    return std::chrono::steady_clock::now() - start;
+  };
+
+  auto iteration_time = [&](const auto& c) {
+    auto start = std::chrono::steady_clock::now();
+    long long sum = 0;
+    for (int round = 0; round < 10; ++round) {
+      for (int value : c) {
+        sum += value;
+      }
+    }
+    EXPECT_EQ(10LL * n * (n - 1) / 2, sum);
+    return std::chrono::steady_clock::now() - start;
+  };
+
+  RecordProperty("btree_lookup_us", us(lookup_time(btree)));
+  RecordProperty("set_lookup_us", us(lookup_time(tree)));
+  RecordProperty("btree_iteration_us", us(iteration_time(btree)));
+  RecordProperty("set_iteration_us", us(iteration_time(tree)));
+}
+
+TEST_F(btree_performance_test, insert_erase) {
+  std::vector<int> keys(1'000'000);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+
+  auto start = std::chrono::steady_clock::now();
+  btree_set<int> c;
+  for (int key : keys) {
+    c.insert(key);
+  }
+  EXPECT_EQ(keys.size(), c.size());
+  for (int key : keys) {
+    c.erase(key);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  RecordProperty("insert_erase_us",
+                 static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+  expect_empty(c);
+}
+
+namespace {
+
+template <typename C, typename Value>
+void run_btree_random_test(Value make_value, std::mt19937::result_type seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution key_dist(0, 2'000);
+  std::uniform_int_distribution op_dist(0, 9);
+
+  C c;
+  std::set<typename C::value_type> expected;
+  for (size_t i = 0; i < 50'000; ++i) {
+    auto value = make_value(key_dist(rng));
+    int op = op_dist(rng);
+    if (op < 5) {
+      ASSERT_EQ(expected.insert(value).second, c.insert(value).second);
+    } else if (op < 8) {
+      ASSERT_EQ(expected.erase(value), c.erase(value));
+    } else {
+      auto it = c.lower_bound(value);
+      auto expected_it = expected.lower_bound(value);
+      ASSERT_EQ(expected_it == expected.end(), it == c.end());
+      if (it != c.end()) {
+        ASSERT_EQ(*expected_it, *it);
+        it = c.erase(it);
+        expected_it = expected.erase(expected_it);
+        ASSERT_EQ(expected_it == expected.end(), it == c.end());
+        if (it != c.end()) {
+          ASSERT_EQ(*expected_it, *it);
+        }
+      }
+    }
+    ASSERT_EQ(expected.size(), c.size());
+  }
+  ASSERT_TRUE(std::equal(c.begin(), c.end(), expected.begin(), expected.end()));
+  ASSERT_TRUE(std::equal(c.rbegin(), c.rend(), expected.rbegin(), expected.rend()));
+}
+
+} // namespace
+
+TEST_F(btree_random_test, small_nodes) {
+  run_btree_random_test<small_btree>([](int x) { return x; }, 1);
+}
+
+TEST_F(btree_random_test, ints) {
+  run_btree_random_test<btree_set<int>>([](int x) { return x; }, 2);
+}
+
+TEST_F(btree_random_test, strings) {
+  run_btree_random_test<btree_set<std::string>>([](int x) { return std::to_string(x); }, 3);
+}
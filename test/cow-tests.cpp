@@ -0,0 +1,273 @@
+#include "cow-set.h"
+#include "element.h"
+#include "fault-injection.h"
+#include "pool-allocator.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <set>
+#include <vector>
+
+template class cow_set<element>;
+template class cow_set<element, std::less<>>;
+template class cow_set<element, std::less<element>, pool_allocator<element>>;
+template class cow_set<int, std::less<int>, std::allocator<int>, with_order_statistics<>>;
+
+namespace {
+
+class cow_correctness_test : public base_test {};
+
+class cow_exception_safety_test : public base_test {};
+
+class cow_performance_test : public base_test {};
+
+class cow_random_test : public base_test {};
+
+template <typename C>
+bool shares_tree(const C& a, const C& b) {
+  return !a.empty() && &*a.begin() == &*b.begin();
+}
+
+} // namespace
+
+TEST_F(cow_correctness_test, default_ctor) {
+  cow_set<element> c;
+  expect_empty(c);
+  EXPECT_EQ(c.end(), c.find(1));
+  EXPECT_EQ(0, c.erase(1));
+  c.clear();
+  expect_empty(c);
+}
+
+TEST_F(cow_correctness_test, copy_shares_tree) {
+  cow_set<element> a;
+  mass_insert(a, {5, 2, 8, 1});
+
+  size_t created = element::created_instances();
+  cow_set<element> b = a;
+  cow_set<element> c;
+  c = b;
+  EXPECT_EQ(created, element::created_instances());
+  EXPECT_TRUE(shares_tree(a, b));
+  EXPECT_TRUE(shares_tree(a, c));
+  expect_eq(c, {1, 2, 5, 8});
+}
+
+TEST_F(cow_correctness_test, mutation_clones) {
+  cow_set<element> a;
+  mass_insert(a, {5, 2, 8, 1});
+  cow_set<element> b = a;
+  auto a_first = a.begin();
+
+  b.insert(3);
+  EXPECT_FALSE(shares_tree(a, b));
+  expect_eq(a, {1, 2, 5, 8});
+  expect_eq(b, {1, 2, 3, 5, 8});
+  EXPECT_EQ(a.begin(), a_first);
+
+  cow_set<element> c = b;
+  EXPECT_EQ(1, c.erase(5));
+  expect_eq(b, {1, 2, 3, 5, 8});
+  expect_eq(c, {1, 2, 3, 8});
+
+  c.insert(4);
+  EXPECT_EQ(4, *c.find(4));
+}
+
+TEST_F(cow_correctness_test, no_op_mutations_keep_sharing) {
+  cow_set<element> a;
+  mass_insert(a, {1, 2, 3});
+  cow_set<element> b = a;
+
+  element two = 2;
+  element three = 3;
+  element seven = 7;
+  size_t created = element::created_instances();
+  auto [it, inserted] = b.insert(two);
+  EXPECT_FALSE(inserted);
+  EXPECT_EQ(2, *it);
+  EXPECT_EQ(3, *b.insert(b.end(), three));
+  EXPECT_EQ(0, b.erase(seven));
+  EXPECT_EQ(created, element::created_instances());
+  EXPECT_TRUE(shares_tree(a, b));
+
+  auto [emplaced, emplaced_new] = b.emplace(1);
+  EXPECT_FALSE(emplaced_new);
+  EXPECT_EQ(a.begin(), emplaced);
+  EXPECT_EQ(std::next(a.begin()), b.emplace_hint(b.end(), 2));
+  EXPECT_TRUE(shares_tree(a, b));
+
+  b.emplace(4);
+  EXPECT_FALSE(shares_tree(a, b));
+  expect_eq(b, {1, 2, 3, 4});
+  b.emplace_hint(b.end(), 5);
+  expect_eq(b, {1, 2, 3, 4, 5});
+}
+
+TEST_F(cow_correctness_test, iterator_mutations_on_shared_tree) {
+  cow_set<element> a;
+  mass_insert(a, {1, 2, 3, 4, 5});
+
+  cow_set<element> b = a;
+  auto it = b.erase(b.find(3));
+  EXPECT_EQ(4, *it);
+  expect_eq(b, {1, 2, 4, 5});
+  expect_eq(a, {1, 2, 3, 4, 5});
+
+  cow_set<element> c = a;
+  auto pos = c.insert(c.find(4), 0);
+  EXPECT_EQ(0, *pos);
+  expect_eq(c, {0, 1, 2, 3, 4, 5});
+
+  cow_set<element> d = a;
+  d.emplace_hint(d.end(), 6);
+  expect_eq(d, {1, 2, 3, 4, 5, 6});
+
+  cow_set<element> e = a;
+  auto last = e.erase(std::prev(e.end()));
+  EXPECT_EQ(e.end(), last);
+  expect_eq(e, {1, 2, 3, 4});
+  expect_eq(a, {1, 2, 3, 4, 5});
+}
+
+TEST_F(cow_correctness_test, from_set) {
+  set<element> s;
+  mass_insert(s, {3, 1, 2});
+  cow_set<element> c(std::move(s));
+  expect_empty(s);
+  expect_eq(c, {1, 2, 3});
+
+  std::vector<int> v = {4, 6, 5};
+  cow_set<element> r(v.begin(), v.end());
+  expect_eq(r, {4, 5, 6});
+}
+
+TEST_F(cow_correctness_test, swap_and_move) {
+  cow_set<element> a;
+  mass_insert(a, {1, 2});
+  cow_set<element> b;
+  mass_insert(b, {3});
+
+  swap(a, b);
+  expect_eq(a, {3});
+  expect_eq(b, {1, 2});
+
+  cow_set<element> c = std::move(b);
+  expect_empty(b);
+  expect_eq(c, {1, 2});
+  b = std::move(c);
+  expect_eq(b, {1, 2});
+}
+
+TEST_F(cow_correctness_test, transparent_lookup) {
+  cow_set<element, std::less<>> a;
+  mass_insert(a, {1, 3, 5});
+  cow_set<element, std::less<>> b = a;
+
+  size_t created = element::created_instances();
+  EXPECT_EQ(3, *b.find(3));
+  EXPECT_EQ(5, *b.lower_bound(4));
+  EXPECT_EQ(0, b.erase(4));
+  EXPECT_EQ(created, element::created_instances());
+  EXPECT_EQ(1, b.erase(3));
+  expect_eq(a, {1, 3, 5});
+  expect_eq(b, {1, 5});
+}
+
+TEST_F(cow_correctness_test, pool_allocator) {
+  node_pool pool;
+  cow_set<element, std::less<element>, pool_allocator<element>> a{std::less<element>(), pool_allocator<element>(pool)};
+  for (int i = 0; i < 100; ++i) {
+    a.insert(i);
+  }
+  auto b = a;
+  b.erase(50);
+  EXPECT_EQ(100, a.size());
+  EXPECT_EQ(99, b.size());
+  EXPECT_EQ(pool_allocator<element>(pool), b.get_allocator());
+}
+
+TEST_F(cow_exception_safety_test, mutate_shared) {
+  faulty_run([] {
+    cow_set<element> a;
+    {
+      fault_injection_disable dg;
+      mass_insert_balanced(a, 20);
+    }
+    strong_exception_safety_guard sg_a(a);
+    cow_set<element> b = a;
+    {
+      strong_exception_safety_guard sg_b(b);
+      b.insert(100);
+    }
+    cow_set<element> c = b;
+    {
+      strong_exception_safety_guard sg_c(c);
+      c.erase(c.begin());
+    }
+    strong_exception_safety_guard sg_b(b);
+    b.erase(5);
+  });
+}
+
+TEST_F(cow_performance_test, copies) {
+  std::vector<int> v(1'000'000);
+  std::iota(v.begin(), v.end(), 0);
+  cow_set<int> c(v.begin(), v.end());
+
+  std::vector<cow_set<int>> copies;
+  copies.reserve(1'000'000);
+  size_t allocations = allocations_made();
+  for (int i = 0; i < 1'000'000; ++i) {
+    copies.push_back(c);
+    copies.back().erase(-1);
+  }
+  EXPECT_EQ(allocations, allocations_made());
+  EXPECT_EQ(1'000'000, copies.back().size());
+  EXPECT_EQ(c.begin(), copies.back().begin());
+}
+
+TEST_F(cow_random_test, handles) {
+  std::mt19937 rng(31);
+  std::uniform_int_distribution value_dist(1, 500);
+  std::uniform_int_distribution op_dist(0, 9);
+
+  constexpr size_t handles = 8;
+  std::vector<std::set<int>> expected(handles);
+  std::vector<cow_set<int>> actual(handles);
+  std::uniform_int_distribution<size_t> handle_dist(0, handles - 1);
+
+  for (size_t i = 0; i < 20'000; ++i) {
+    size_t h = handle_dist(rng);
+    int e = value_dist(rng);
+    int op = op_dist(rng);
+    if (op < 4) {
+      ASSERT_EQ(expected[h].insert(e).second, actual[h].insert(e).second);
+    } else if (op < 6) {
+      actual[h].insert(actual[h].lower_bound(e), e);
+      expected[h].insert(e);
+    } else if (op < 8) {
+      ASSERT_EQ(expected[h].erase(e), actual[h].erase(e));
+    } else if (op < 9) {
+      auto it = actual[h].lower_bound(e);
+      if (it != actual[h].end()) {
+        expected[h].erase(*it);
+        actual[h].erase(it);
+      }
+    } else {
+      size_t from = handle_dist(rng);
+      expected[h] = expected[from];
+      actual[h] = actual[from];
+    }
+    for (size_t j = 0; j < handles; ++j) {
+      ASSERT_EQ(expected[j].size(), actual[j].size());
+    }
+  }
+  for (size_t j = 0; j < handles; ++j) {
+    ASSERT_TRUE(std::equal(actual[j].begin(), actual[j].end(), expected[j].begin(), expected[j].end()));
+  }
+}
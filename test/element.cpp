@@ -155,6 +155,7 @@ void element::add_instance() {
        << " while the previous object at this address was not destroyed";
     throw std::logic_error(ss.str());
   }
+  ++created;
 }
 
 void element::delete_instance() {
@@ -177,7 +178,12 @@ void element::assert_exists() const {
   }
 }
 
+size_t element::created_instances() noexcept {
+  return created;
+}
+
 std::set<const element*> element::instances;
+size_t element::created = 0;
 
 element::no_new_instances_guard::no_new_instances_guard() : old_instances(instances) {}
 
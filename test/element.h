@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <set>
 
 struct element {
@@ -34,6 +35,8 @@ struct element {
   friend bool operator>(int a, const element& b);
   friend bool operator>=(int a, const element& b);
 
+  static size_t created_instances() noexcept;
+
 private:
   void add_instance();
   void delete_instance();
@@ -43,6 +46,7 @@ private:
   int data;
 
   static std::set<const element*> instances;
+  static size_t created;
 };
 
 struct element::no_new_instances_guard {
@@ -6,7 +6,12 @@
 
 namespace {
 
+thread_local size_t allocations = 0;
+thread_local size_t allocated = 0;
+
 void* injected_allocate(size_t count) {
+  ++allocations;
+  allocated += count;
   if (should_inject_fault()) {
     throw std::bad_alloc();
   }
@@ -127,6 +132,14 @@ void faulty_run(const std::function<void()>& f) {
   context = nullptr;
 }
 
+size_t allocations_made() noexcept {
+  return allocations;
+}
+
+size_t allocated_bytes() noexcept {
+  return allocated;
+}
+
 fault_injection_disable::fault_injection_disable() : was_disabled(disabled) {
   disabled = true;
 }
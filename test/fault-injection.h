@@ -11,6 +11,12 @@ bool should_inject_fault();
 void fault_injection_point();
 void faulty_run(const std::function<void()>& f);
 
+// Number of calls to the global `operator new` made by this thread so far.
+size_t allocations_made() noexcept;
+
+// Number of bytes requested from the global `operator new` by this thread so far.
+size_t allocated_bytes() noexcept;
+
 struct fault_injection_disable {
   fault_injection_disable();
 
@@ -0,0 +1,232 @@
+#include "element.h"
+#include "fault-injection.h"
+#include "frozen-set.h"
+#include "pool-allocator.h"
+#include "set.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+template class frozen_set<int>;
+template class frozen_set<element>;
+template class frozen_set<std::string>;
+template class frozen_set<element, std::less<>>;
+template class frozen_set<int, std::less<int>, pool_allocator<int>>;
+
+namespace {
+
+class frozen_correctness_test : public base_test {};
+
+class frozen_exception_safety_test : public base_test {};
+
+class frozen_performance_test : public base_test {};
+
+class frozen_random_test : public base_test {};
+
+} // namespace
+
+TEST_F(frozen_correctness_test, default_ctor) {
+  frozen_set<element> c;
+  expect_empty(c);
+  EXPECT_EQ(c.end(), c.find(1));
+  EXPECT_EQ(c.end(), c.lower_bound(1));
+  EXPECT_EQ(c.end(), c.upper_bound(1));
+}
+
+TEST_F(frozen_correctness_test, freeze) {
+  set<element> s;
+  mass_insert(s, {8, 3, 5, 1, 9, 2, 7});
+  frozen_set<element> c = freeze(s);
+  expect_eq(c, {1, 2, 3, 5, 7, 8, 9});
+  expect_eq(reverse_view(c), {9, 8, 7, 5, 3, 2, 1});
+  expect_eq(s, {1, 2, 3, 5, 7, 8, 9});
+}
+
+TEST_F(frozen_correctness_test, freeze_policies) {
+  set<int, std::less<int>, std::allocator<int>, unbalanced_tree_policy> unbalanced;
+  set<int, std::less<int>, std::allocator<int>, with_order_statistics<>> ranked;
+  for (int i = 0; i < 100; ++i) {
+    unbalanced.insert(i);
+    ranked.insert(99 - i);
+  }
+  auto a = freeze(unbalanced);
+  auto b = freeze(ranked);
+  EXPECT_TRUE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+  EXPECT_EQ(100, a.size());
+}
+
+TEST_F(frozen_correctness_test, every_size) {
+  for (int n = 0; n < 70; ++n) {
+    std::vector<int> values(n);
+    std::iota(values.begin(), values.end(), 0);
+    frozen_set<int> c(sorted_unique, values.begin(), values.end());
+    ASSERT_EQ(n, c.size());
+    expect_eq(c, values);
+    expect_eq(reverse_view(c), std::vector<int>(values.rbegin(), values.rend()));
+  }
+}
+
+TEST_F(frozen_correctness_test, find) {
+  std::vector<int> values(50);
+  std::generate(values.begin(), values.end(), [i = 0]() mutable { return 2 * i++; });
+  frozen_set<int> c(sorted_unique, values.begin(), values.end());
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(2 * i, *c.find(2 * i));
+    EXPECT_TRUE(c.contains(2 * i));
+    EXPECT_EQ(c.end(), c.find(2 * i + 1));
+    EXPECT_FALSE(c.contains(2 * i + 1));
+  }
+  EXPECT_EQ(c.end(), c.find(-1));
+}
+
+TEST_F(frozen_correctness_test, bounds) {
+  std::vector<int> values(50);
+  std::generate(values.begin(), values.end(), [i = 0]() mutable { return 2 * i++; });
+  frozen_set<int> c(sorted_unique, values.begin(), values.end());
+  for (int i = -1; i < 100; ++i) {
+    int lower = i <= 0 ? 0 : (i + 1) / 2 * 2;
+    int upper = i < 0 ? 0 : i / 2 * 2 + 2;
+    if (lower < 100) {
+      EXPECT_EQ(lower, *c.lower_bound(i));
+    } else {
+      EXPECT_EQ(c.end(), c.lower_bound(i));
+    }
+    if (upper < 100) {
+      EXPECT_EQ(upper, *c.upper_bound(i));
+    } else {
+      EXPECT_EQ(c.end(), c.upper_bound(i));
+    }
+  }
+}
+
+TEST_F(frozen_correctness_test, iterate_from_lookup) {
+  set<int> s;
+  for (int i = 0; i < 100; ++i) {
+    s.insert(i);
+  }
+  auto c = freeze(s);
+  auto it = c.lower_bound(40);
+  for (int i = 40; i < 100; ++i, ++it) {
+    ASSERT_EQ(i, *it);
+  }
+  EXPECT_EQ(c.end(), it);
+  for (int i = 99; i >= 0; --i) {
+    ASSERT_EQ(i, *--it);
+  }
+  EXPECT_EQ(c.begin(), it);
+}
+
+TEST_F(frozen_correctness_test, copy_move) {
+  set<element> s;
+  mass_insert(s, {4, 2, 6, 1, 3, 5, 7});
+  frozen_set<element> c = freeze(s);
+
+  frozen_set<element> c2 = c;
+  expect_eq(c2, {1, 2, 3, 4, 5, 6, 7});
+
+  frozen_set<element> c3 = std::move(c2);
+  expect_empty(c2);
+  expect_eq(c3, {1, 2, 3, 4, 5, 6, 7});
+
+  c2 = c3;
+  c3 = std::move(c);
+  expect_empty(c);
+  expect_eq(c2, {1, 2, 3, 4, 5, 6, 7});
+  expect_eq(c3, {1, 2, 3, 4, 5, 6, 7});
+
+  swap(c, c3);
+  expect_empty(c3);
+  EXPECT_EQ(4, *c.find(4));
+}
+
+TEST_F(frozen_correctness_test, transparent_lookup) {
+  set<element, std::less<>> s;
+  mass_insert(s, {1, 3, 5});
+  auto c = freeze(s);
+  element::no_new_instances_guard guard;
+  EXPECT_EQ(3, *c.find(3));
+  EXPECT_EQ(5, *c.lower_bound(4));
+  EXPECT_EQ(5, *c.upper_bound(3));
+  EXPECT_FALSE(c.contains(4));
+}
+
+TEST_F(frozen_correctness_test, pool_allocator) {
+  node_pool pool;
+  set<int, std::less<int>, pool_allocator<int>> s{pool_allocator<int>(pool)};
+  for (int i = 0; i < 1000; ++i) {
+    s.insert(i);
+  }
+  auto c = freeze(s);
+  EXPECT_EQ(1000, c.size());
+  EXPECT_EQ(500, *c.find(500));
+}
+
+TEST_F(frozen_exception_safety_test, freeze) {
+  faulty_run([] {
+    set<element> s;
+    {
+      fault_injection_disable dg;
+      mass_insert_balanced(s, 20);
+    }
+    strong_exception_safety_guard sg(s);
+    frozen_set<element> c = freeze(s);
+    frozen_set<element> c2 = c;
+    c = c2;
+  });
+}
+
+TEST_F(frozen_performance_test, lower_bound_vs_set) {
+  constexpr int n = 1'000'000;
+  std::vector<int> values(n);
+  std::iota(values.begin(), values.end(), 0);
+  std::vector<int> keys(n);
+  std::mt19937 rng(42);
+  std::uniform_int_distribution key_dist(0, 2 * n);
+  std::generate(keys.begin(), keys.end(), [&] { return key_dist(rng); });
+
+  set<int> tree(sorted_unique, values.begin(), values.end());
+  frozen_set<int> frozen = freeze(tree);
+
+  auto lookup_time = [&](const auto& c) {
+    auto start = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for (int key : keys) {
+      found += c.lower_bound(key) != c.end();
+    }
+    EXPECT_EQ(std::count_if(keys.begin(), keys.end(), [](int key) { return key < n; }), found);
+    return std::chrono::steady_clock::now() - start;
+  };
+
+  EXPECT_LT(lookup_time(frozen), lookup_time(tree));
+}
+
+TEST_F(frozen_random_test, lookups) {
+  std::mt19937 rng(12);
+  for (int round = 0; round < 50; ++round) {
+    std::uniform_int_distribution key_dist(0, 1'000);
+    std::set<int> expected;
+    size_t n = std::uniform_int_distribution<size_t>(0, 500)(rng);
+    for (size_t i = 0; i < n; ++i) {
+      expected.insert(key_dist(rng));
+    }
+    frozen_set<int> c(sorted_unique, expected.begin(), expected.end());
+    ASSERT_TRUE(std::equal(c.begin(), c.end(), expected.begin(), expected.end()));
+    ASSERT_TRUE(std::equal(c.rbegin(), c.rend(), expected.rbegin(), expected.rend()));
+    for (int i = 0; i < 1'000; ++i) {
+      int key = key_dist(rng);
+      auto lower = expected.lower_bound(key);
+      auto upper = expected.upper_bound(key);
+      ASSERT_EQ(std::distance(expected.begin(), lower), std::distance(c.begin(), c.lower_bound(key)));
+      ASSERT_EQ(std::distance(expected.begin(), upper), std::distance(c.begin(), c.upper_bound(key)));
+      ASSERT_EQ(expected.contains(key), c.find(key) != c.end());
+    }
+  }
+}
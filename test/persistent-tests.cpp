@@ -0,0 +1,337 @@
+#include "element.h"
+#include "fault-injection.h"
+#include "persistent-set.h"
+#include "pool-allocator.h"
+#include "test-utils.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+template class persistent_set<int>;
+template class persistent_set<element>;
+template class persistent_set<std::string>;
+template class persistent_set<element, std::less<>>;
+template class persistent_set<int, std::less<int>, pool_allocator<int>>;
+
+namespace {
+
+class persistent_correctness_test : public base_test {};
+
+class persistent_exception_safety_test : public base_test {};
+
+class persistent_performance_test : public base_test {};
+
+class persistent_random_test : public base_test {};
+
+persistent_set<element> make_persistent(std::initializer_list<int> values) {
+  persistent_set<element> result;
+  for (int value : values) {
+    result = result.insert(value);
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_F(persistent_correctness_test, default_ctor) {
+  persistent_set<element> c;
+  expect_empty(c);
+  EXPECT_EQ(c.end(), c.find(1));
+  EXPECT_EQ(c.end(), c.lower_bound(1));
+}
+
+TEST_F(persistent_correctness_test, insert) {
+  persistent_set<element> c = make_persistent({5, 2, 8, 1, 9, 3, 7, 4, 6, 0});
+  expect_eq(c, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+  expect_eq(reverse_view(c), {9, 8, 7, 6, 5, 4, 3, 2, 1, 0});
+
+  persistent_set<element> same = c.insert(5);
+  EXPECT_EQ(10, same.size());
+  EXPECT_EQ(&*c.find(5), &*same.find(5));
+}
+
+TEST_F(persistent_correctness_test, versions) {
+  persistent_set<element> v1 = make_persistent({1, 2, 3});
+  persistent_set<element> v2 = v1.insert(4);
+  persistent_set<element> v3 = v2.erase(1);
+  persistent_set<element> v4 = v3.erase(10);
+
+  expect_eq(v1, {1, 2, 3});
+  expect_eq(v2, {1, 2, 3, 4});
+  expect_eq(v3, {2, 3, 4});
+  expect_eq(v4, {2, 3, 4});
+
+  v2 = persistent_set<element>();
+  expect_eq(v1, {1, 2, 3});
+  expect_eq(v3, {2, 3, 4});
+}
+
+TEST_F(persistent_correctness_test, structural_sharing) {
+  persistent_set<element> c;
+  for (int i = 0; i < 1'000; ++i) {
+    c = c.insert(i);
+  }
+
+  size_t created = element::created_instances();
+  persistent_set<element> snapshot = c;
+  EXPECT_EQ(created, element::created_instances());
+
+  persistent_set<element> updated = c.insert(1'000).erase(500);
+  // An AVL tree of 1000 nodes is at most 14 levels high, rotations add a few nodes per level.
+  EXPECT_LE(element::created_instances() - created, 3 * 14 + 2);
+  size_t shared = 0;
+  for (int i = 0; i < 1'000; ++i) {
+    shared += i != 500 && &*snapshot.find(i) == &*updated.find(i);
+  }
+  EXPECT_GE(shared, 999 - (3 * 14 + 2));
+  EXPECT_EQ(1'000, updated.size());
+  EXPECT_FALSE(updated.contains(500));
+  EXPECT_TRUE(snapshot.contains(500));
+}
+
+TEST_F(persistent_correctness_test, iterators_outlive_derived_versions) {
+  persistent_set<int> v1;
+  for (int i = 0; i < 1'000; ++i) {
+    v1 = v1.insert(i);
+  }
+  auto it = v1.find(0);
+  auto rit = v1.rbegin();
+  for (int i = 0; i < 100; ++i) {
+    persistent_set<int> v2 = v1.insert(1'000 + i).erase(i);
+    EXPECT_EQ(1'000, v2.size());
+  }
+
+  persistent_set<int> copy = v1;
+  v1 = persistent_set<int>();
+  for (int i = 0; i < 1'000; ++i, ++it) {
+    ASSERT_EQ(i, *it);
+  }
+  EXPECT_EQ(copy.end(), it);
+  for (int i = 999; i >= 0; --i, ++rit) {
+    ASSERT_EQ(i, *rit);
+  }
+  EXPECT_EQ(copy.rend(), rit);
+}
+
+TEST_F(persistent_correctness_test, erase) {
+  persistent_set<element> c;
+  for (int i = 0; i < 100; ++i) {
+    c = c.insert(i);
+  }
+  persistent_set<element> full = c;
+  for (int i = 0; i < 100; i += 3) {
+    c = c.erase(i);
+  }
+  std::vector<int> expected;
+  for (int i = 0; i < 100; ++i) {
+    if (i % 3 != 0) {
+      expected.push_back(i);
+    }
+  }
+  expect_eq(c, expected);
+  EXPECT_EQ(100, full.size());
+}
+
+TEST_F(persistent_correctness_test, bounds) {
+  persistent_set<int> c;
+  for (int i = 0; i < 50; ++i) {
+    c = c.insert(2 * i);
+  }
+  for (int i = -1; i < 100; ++i) {
+    int lower = i <= 0 ? 0 : (i + 1) / 2 * 2;
+    int upper = i < 0 ? 0 : i / 2 * 2 + 2;
+    if (lower < 100) {
+      EXPECT_EQ(lower, *c.lower_bound(i));
+    } else {
+      EXPECT_EQ(c.end(), c.lower_bound(i));
+    }
+    if (upper < 100) {
+      EXPECT_EQ(upper, *c.upper_bound(i));
+    } else {
+      EXPECT_EQ(c.end(), c.upper_bound(i));
+    }
+    EXPECT_EQ(i >= 0 && i % 2 == 0, c.find(i) != c.end());
+  }
+
+  auto it = c.find(40);
+  for (int i = 40; i < 100; i += 2, ++it) {
+    ASSERT_EQ(i, *it);
+  }
+  EXPECT_EQ(c.end(), it);
+  for (int i = 98; i >= 0; i -= 2) {
+    ASSERT_EQ(i, *--it);
+  }
+  EXPECT_EQ(c.begin(), it);
+}
+
+TEST_F(persistent_correctness_test, sorted_unique_ctor) {
+  std::vector<int> values(1'000);
+  std::iota(values.begin(), values.end(), 0);
+  persistent_set<int> c(sorted_unique, values.begin(), values.end());
+  expect_eq(c, values);
+  for (int i = 0; i < 1'000; i += 2) {
+    c = c.erase(i);
+  }
+  EXPECT_EQ(500, c.size());
+  EXPECT_EQ(1, *c.begin());
+
+  persistent_set<int> unsorted(values.rbegin(), values.rend());
+  expect_eq(unsorted, values);
+}
+
+TEST_F(persistent_correctness_test, transparent_lookup) {
+  persistent_set<element, std::less<>> c;
+  c = c.insert(1).insert(3).insert(5);
+
+  size_t created = element::created_instances();
+  EXPECT_EQ(3, *c.find(3));
+  EXPECT_EQ(5, *c.lower_bound(4));
+  EXPECT_TRUE(c.contains(1));
+  persistent_set<element, std::less<>> erased = c.erase(3);
+  EXPECT_EQ(created + 1, element::created_instances());
+  expect_eq(erased, {1, 5});
+}
+
+TEST_F(persistent_correctness_test, pool_allocator) {
+  node_pool pool;
+  persistent_set<int, std::less<int>, pool_allocator<int>> c{std::less<int>(), pool_allocator<int>(pool)};
+  std::vector<persistent_set<int, std::less<int>, pool_allocator<int>>> versions;
+  for (int i = 0; i < 1'000; ++i) {
+    c = c.insert(i);
+    if (i % 100 == 0) {
+      versions.push_back(c);
+    }
+  }
+  EXPECT_EQ(1'000, c.size());
+  EXPECT_EQ(1, versions[0].size());
+  EXPECT_EQ(901, versions.back().size());
+}
+
+TEST_F(persistent_correctness_test, concurrent_readers) {
+  persistent_set<int> shared;
+  for (int i = 0; i < 10'000; ++i) {
+    shared = shared.insert(i);
+  }
+
+  std::atomic<bool> failed = false;
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([snapshot = shared, &failed] {
+      for (int round = 0; round < 20; ++round) {
+        persistent_set<int> copy = snapshot;
+        long long sum = 0;
+        for (int value : copy) {
+          sum += value;
+        }
+        if (sum != 10'000LL * 9'999 / 2) {
+          failed = true;
+        }
+      }
+    });
+  }
+  for (int i = 0; i < 10'000; i += 2) {
+    shared = shared.erase(i);
+  }
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  EXPECT_FALSE(failed);
+  EXPECT_EQ(5'000, shared.size());
+}
+
+TEST_F(persistent_exception_safety_test, insert_erase) {
+  faulty_run([] {
+    persistent_set<element> c;
+    {
+      fault_injection_disable dg;
+      for (int i = 0; i < 20; ++i) {
+        c = c.insert(i * 2);
+      }
+    }
+    strong_exception_safety_guard sg(c);
+    persistent_set<element> inserted = c.insert(7);
+    persistent_set<element> erased = inserted.erase(10);
+    c = erased;
+  });
+}
+
+TEST_F(persistent_exception_safety_test, sorted_unique_ctor) {
+  faulty_run([] {
+    std::vector<element> values;
+    {
+      fault_injection_disable dg;
+      for (int i = 0; i < 20; ++i) {
+        values.emplace_back(i);
+      }
+    }
+    persistent_set<element> c(sorted_unique, values.begin(), values.end());
+  });
+}
+
+TEST_F(persistent_performance_test, snapshots_and_updates) {
+  constexpr int N = 1'000'000;
+  std::vector<int> values(N);
+  std::iota(values.begin(), values.end(), 0);
+  persistent_set<int> c(sorted_unique, values.begin(), values.end());
+
+  constexpr int K = 100'000;
+  std::vector<persistent_set<int>> snapshots;
+  snapshots.reserve(K / 100);
+  size_t allocations = allocations_made();
+  for (int i = 0; i < K; ++i) {
+    c = c.erase(i * 7 % N).insert(N + i);
+    if (i % 100 == 0) {
+      snapshots.push_back(c);
+    }
+  }
+  // Every update copies only the nodes on its path, the rest is shared with the previous version.
+  EXPECT_LE(allocations_made() - allocations, K * 4 * std::bit_width(static_cast<size_t>(2 * N)));
+  EXPECT_EQ(N, c.size());
+  EXPECT_EQ(N, snapshots.front().size());
+  EXPECT_TRUE(snapshots.front().contains(N));
+  EXPECT_FALSE(snapshots.front().contains(N + 1));
+  EXPECT_FALSE(c.contains(0));
+}
+
+TEST_F(persistent_random_test, versions) {
+  std::mt19937 rng(97);
+  std::uniform_int_distribution value_dist(1, 1'000);
+  std::uniform_real_distribution real_dist;
+
+  std::vector<std::set<int>> expected(1);
+  std::vector<persistent_set<int>> versions(1);
+  for (size_t i = 0; i < 20'000; ++i) {
+    size_t base = std::uniform_int_distribution<size_t>(0, versions.size() - 1)(rng);
+    int e = value_dist(rng);
+    std::set<int> next = expected[base];
+    persistent_set<int> version = versions[base];
+    if (real_dist(rng) < .6) {
+      next.insert(e);
+      version = version.insert(e);
+    } else {
+      next.erase(e);
+      version = version.erase(e);
+    }
+    ASSERT_EQ(next.size(), version.size());
+    if (versions.size() < 50) {
+      expected.push_back(std::move(next));
+      versions.push_back(std::move(version));
+    } else {
+      expected[i % 50] = std::move(next);
+      versions[i % 50] = std::move(version);
+    }
+  }
+  for (size_t i = 0; i < versions.size(); ++i) {
+    ASSERT_TRUE(std::equal(versions[i].begin(), versions[i].end(), expected[i].begin(), expected[i].end()));
+    ASSERT_TRUE(std::equal(versions[i].rbegin(), versions[i].rend(), expected[i].rbegin(), expected[i].rend()));
+  }
+}
@@ -2,6 +2,7 @@
 
 #include "element.h"
 #include "fault-injection.h"
+#include "pool-allocator.h"
 #include "set.h"
 
 #include <gtest/gtest.h>
@@ -14,6 +15,30 @@
 template class set<element>;
 using container = set<element>;
 
+template class set<element, std::less<element>, std::allocator<element>, unbalanced_tree_policy>;
+using unbalanced_container = set<element, std::less<element>, std::allocator<element>, unbalanced_tree_policy>;
+
+template class set<element, std::less<element>, std::allocator<element>, splay_tree_policy>;
+using splay_container = set<element, std::less<element>, std::allocator<element>, splay_tree_policy>;
+
+template class set<element, std::less<element>, std::allocator<element>, treap_policy<>>;
+using treap_container = set<element, std::less<element>, std::allocator<element>, treap_policy<>>;
+
+template class set<element, std::less<element>, std::allocator<element>, scapegoat_tree_policy>;
+using scapegoat_container = set<element, std::less<element>, std::allocator<element>, scapegoat_tree_policy>;
+
+template class set<element, std::less<element>, std::allocator<element>, with_order_statistics<>>;
+using order_statistics_container = set<element, std::less<element>, std::allocator<element>, with_order_statistics<>>;
+
+template class set<element, std::less<element>, std::allocator<element>, with_in_order_links<>>;
+using threaded_container = set<element, std::less<element>, std::allocator<element>, with_in_order_links<>>;
+
+template class set<element, std::less<>>;
+using transparent_container = set<element, std::less<>>;
+
+template class set<element, std::less<element>, pool_allocator<element>>;
+using pool_container = set<element, std::less<element>, pool_allocator<element>>;
+
 template <typename F, typename = std::enable_if_t<std::is_invocable_v<F, std::ostream&>>>
 decltype(auto) operator<<(std::ostream& out, const F& f) {
   return f(out);
@@ -5,9 +5,20 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <iterator>
+#include <numeric>
+#include <optional>
 #include <random>
+#include <span>
+#include <string>
+#include <string_view>
 #include <type_traits>
+#include <vector>
 
 static_assert(!std::is_constructible_v<container::iterator, std::nullptr_t>,
               "iterator should not be constructible from nullptr");
@@ -18,6 +29,12 @@ static_assert(!std::is_constructible_v<container::reverse_iterator, std::nullptr
 static_assert(!std::is_constructible_v<container::const_reverse_iterator, std::nullptr_t>,
               "const_reverse_iterator should not be constructible from nullptr");
 
+template <typename C>
+concept has_order_statistics = requires(const C& c) { c.nth(0); };
+
+static_assert(!has_order_statistics<container>, "order statistics should be opt-in");
+static_assert(has_order_statistics<order_statistics_container>);
+
 namespace {
 
 class correctness_test : public base_test {};
@@ -34,6 +51,15 @@ class random_test : public base_test {};
 
 void magic(const element&) {}
 
+struct counting_less {
+  size_t* comparisons;
+
+  bool operator()(int a, int b) const {
+    ++*comparisons;
+    return a < b;
+  }
+};
+
 } // namespace
 
 TEST_F(correctness_test, default_ctor) {
@@ -136,6 +162,127 @@ TEST_F(correctness_test, insert_duplicate_return_value) {
   EXPECT_EQ(8, *std::next(it));
 }
 
+TEST_F(correctness_test, insert_hint_end) {
+  container c;
+  for (int i = 1; i <= 6; ++i) {
+    container::iterator it = c.insert(c.end(), i);
+    EXPECT_EQ(i, *it);
+  }
+  expect_eq(c, {1, 2, 3, 4, 5, 6});
+}
+
+TEST_F(correctness_test, insert_hint_before) {
+  container c;
+  mass_insert(c, {1, 5, 9, 7, 3});
+
+  container::iterator it = c.insert(c.find(5), 4);
+  EXPECT_EQ(4, *it);
+  EXPECT_EQ(5, *std::next(it));
+
+  it = c.insert(c.begin(), 0);
+  EXPECT_EQ(c.begin(), it);
+
+  it = c.insert(c.find(9), 8);
+  EXPECT_EQ(8, *it);
+  expect_eq(c, {0, 1, 3, 4, 5, 7, 8, 9});
+}
+
+TEST_F(correctness_test, insert_hint_after) {
+  container c;
+  mass_insert(c, {1, 5, 9, 7, 3});
+
+  container::iterator it = c.insert(c.find(5), 6);
+  EXPECT_EQ(6, *it);
+  EXPECT_EQ(5, *std::prev(it));
+
+  it = c.insert(c.find(9), 10);
+  EXPECT_EQ(10, *it);
+  expect_eq(c, {1, 3, 5, 6, 7, 9, 10});
+}
+
+TEST_F(correctness_test, insert_hint_wrong) {
+  container c;
+  mass_insert(c, {1, 5, 9, 7, 3});
+
+  container::iterator it = c.insert(c.begin(), 8);
+  EXPECT_EQ(8, *it);
+  it = c.insert(c.end(), 2);
+  EXPECT_EQ(2, *it);
+  it = c.insert(c.find(3), 6);
+  EXPECT_EQ(6, *it);
+  expect_eq(c, {1, 2, 3, 5, 6, 7, 8, 9});
+}
+
+TEST_F(correctness_test, insert_hint_duplicate) {
+  container c;
+  mass_insert(c, {1, 5, 9, 7, 3});
+
+  EXPECT_EQ(c.find(5), c.insert(c.find(5), 5));
+  EXPECT_EQ(c.find(5), c.insert(c.end(), 5));
+  EXPECT_EQ(c.find(9), c.insert(c.end(), 9));
+  EXPECT_EQ(c.find(1), c.insert(c.begin(), 1));
+  expect_eq(c, {1, 3, 5, 7, 9});
+}
+
+TEST_F(correctness_test, emplace_hint) {
+  container c;
+  mass_insert(c, {1, 5, 9});
+
+  container::iterator it = c.emplace_hint(c.find(5), 4);
+  EXPECT_EQ(4, *it);
+  it = c.emplace_hint(c.end(), 5);
+  EXPECT_EQ(c.find(5), it);
+  expect_eq(c, {1, 4, 5, 9});
+}
+
+TEST_F(correctness_test, insert_hint_comparisons) {
+  constexpr int N = 1000;
+
+  size_t comparisons = 0;
+  set<int, counting_less> c(counting_less{&comparisons});
+  for (int i = 0; i < N; ++i) {
+    c.insert(c.end(), i);
+  }
+  EXPECT_EQ(N - 1, comparisons);
+
+  comparisons = 0;
+  set<int, counting_less> c2(counting_less{&comparisons});
+  for (int i = N; i > 0; --i) {
+    c2.insert(c2.begin(), i);
+  }
+  EXPECT_EQ(N - 1, comparisons);
+}
+
+TEST_F(correctness_test, insert_hint_threaded) {
+  constexpr int N = 500;
+
+  std::vector<int> v;
+  for (int i = 0; i <= N; ++i) {
+    v.push_back(4 * i);
+  }
+  size_t comparisons = 0;
+  set<int, counting_less, std::allocator<int>, with_in_order_links<>> c(sorted_unique, v.begin(), v.end(),
+                                                                        counting_less{&comparisons});
+  // Every hint is right before or right after the new value, so no insertion descends from the root.
+  for (int i = 0; i < N; ++i) {
+    auto hint = std::next(c.find(4 * i));
+    comparisons = 0;
+    auto it = c.insert(hint, 4 * i + 1);
+    EXPECT_EQ(2, comparisons);
+    comparisons = 0;
+    c.insert(it, 4 * i + 3);
+    EXPECT_EQ(3, comparisons);
+    comparisons = 0;
+    c.insert(it, 4 * i + 2);
+    EXPECT_EQ(3, comparisons);
+  }
+  int expected = 0;
+  for (int x : c) {
+    ASSERT_EQ(expected++, x);
+  }
+  EXPECT_EQ(4 * N + 1, expected);
+}
+
 TEST_F(correctness_test, reinsert) {
   container c;
   mass_insert(c, {6, 2, 3, 1, 9, 8});
@@ -168,12 +315,247 @@ TEST_F(correctness_test, copy_ctor_shuffled) {
   expect_eq(c2, {2, 4, 5, 8, 10});
 }
 
+TEST_F(correctness_test, copy_ctor_keeps_shape) {
+  size_t comparisons = 0;
+  auto counting_less = [&comparisons](int a, int b) {
+    ++comparisons;
+    return a < b;
+  };
+  using counting_set =
+      set<int, decltype(counting_less), std::allocator<int>, with_order_statistics<unbalanced_tree_policy>>;
+
+  counting_set c(counting_less);
+  for (int i : {8, 1, 7, 2, 6, 3, 5, 4, 9, 0}) {
+    c.insert(i);
+  }
+  comparisons = 0;
+  counting_set c2 = c;
+  EXPECT_EQ(0, comparisons);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, *c2.nth(i));
+  }
+  EXPECT_TRUE(std::equal(c2.rbegin(), c2.rend(), c.rbegin(), c.rend()));
+}
+
 TEST_F(correctness_test, copy_ctor_empty) {
   container c;
   container c2 = c;
   expect_empty(c2);
 }
 
+TEST_F(correctness_test, range_ctor_sorted) {
+  std::vector<element> v = {1, 2, 3, 4, 5, 6, 7};
+  container c(v.begin(), v.end());
+  expect_eq(c, {1, 2, 3, 4, 5, 6, 7});
+}
+
+TEST_F(correctness_test, range_ctor_sorted_duplicates) {
+  std::vector<element> v = {1, 1, 2, 3, 3, 3, 5, 8, 8};
+  container c(v.begin(), v.end());
+  expect_eq(c, {1, 2, 3, 5, 8});
+
+  constexpr int N = 1000;
+  std::vector<int> w;
+  for (int i = 0; i < N; ++i) {
+    w.insert(w.end(), {i, i});
+  }
+  size_t comparisons = 0;
+  set<int, counting_less> c2(w.begin(), w.end(), counting_less{&comparisons});
+  EXPECT_EQ(N, c2.size());
+  EXPECT_LT(comparisons, 6 * N);
+  EXPECT_EQ(N - 1, *std::prev(c2.end()));
+}
+
+TEST_F(correctness_test, range_ctor_unsorted) {
+  std::vector<element> v = {5, 3, 8, 3, 1, 8};
+  container c(v.begin(), v.end());
+  expect_eq(c, {1, 3, 5, 8});
+}
+
+TEST_F(correctness_test, range_ctor_empty) {
+  std::vector<element> v;
+  container c(v.begin(), v.end());
+  expect_empty(c);
+}
+
+TEST_F(correctness_test, range_ctor_sorted_unique) {
+  std::vector<element> v = {1, 3, 5, 8, 13};
+  container c(sorted_unique, v.begin(), v.end());
+  expect_eq(c, {1, 3, 5, 8, 13});
+
+  c.insert(4);
+  c.erase(8);
+  expect_eq(c, {1, 3, 4, 5, 13});
+}
+
+TEST_F(correctness_test, range_ctor_comparisons) {
+  constexpr int N = 1000;
+  std::vector<int> v(N);
+  std::iota(v.begin(), v.end(), 0);
+
+  size_t comparisons = 0;
+  set<int, counting_less> c(v.begin(), v.end(), counting_less{&comparisons});
+  EXPECT_EQ(N - 1, comparisons);
+  EXPECT_TRUE(std::equal(v.begin(), v.end(), c.begin(), c.end()));
+
+  comparisons = 0;
+  set<int, counting_less> c2(sorted_unique, v.begin(), v.end(), counting_less{&comparisons});
+  EXPECT_EQ(0, comparisons);
+  EXPECT_TRUE(std::equal(v.begin(), v.end(), c2.begin(), c2.end()));
+}
+
+TEST_F(correctness_test, assign) {
+  container c;
+  mass_insert(c, {1, 2, 3, 4});
+
+  std::vector<element> v = {5, 6, 7};
+  c.assign(v.begin(), v.end());
+  expect_eq(c, {5, 6, 7});
+
+  v = {9, 8, 8};
+  c.assign(v.begin(), v.end());
+  expect_eq(c, {8, 9});
+
+  v = {10, 11};
+  c.assign(sorted_unique, v.begin(), v.end());
+  expect_eq(c, {10, 11});
+}
+
+TEST_F(correctness_test, move_ctor) {
+  container c;
+  mass_insert(c, {3, 1, 2, 4});
+  container::const_iterator it = c.find(3);
+  const element* first = &*c.begin();
+
+  size_t created = element::created_instances();
+  container c2 = std::move(c);
+  EXPECT_EQ(created, element::created_instances());
+
+  expect_empty(c);
+  expect_eq(c2, {1, 2, 3, 4});
+  EXPECT_EQ(first, &*c2.begin());
+  EXPECT_EQ(c2.find(3), it);
+  EXPECT_EQ(c2.end(), std::next(it, 2));
+
+  c.insert(5);
+  expect_eq(c, {5});
+}
+
+TEST_F(correctness_test, move_ctor_empty) {
+  container c;
+  container c2 = std::move(c);
+  expect_empty(c);
+  expect_empty(c2);
+}
+
+TEST_F(correctness_test, move_assignment) {
+  container c;
+  mass_insert(c, {1, 2, 3, 4});
+  const element* first = &*c.begin();
+
+  container c2;
+  mass_insert(c2, {5, 6, 7, 8});
+
+  size_t created = element::created_instances();
+  c2 = std::move(c);
+  EXPECT_EQ(created, element::created_instances());
+
+  expect_empty(c);
+  expect_eq(c2, {1, 2, 3, 4});
+  EXPECT_EQ(first, &*c2.begin());
+}
+
+TEST_F(correctness_test, move_assignment_pool) {
+  node_pool pool;
+  node_pool other_pool;
+
+  pool_container c{pool_allocator<element>(pool)};
+  mass_insert(c, {1, 2, 3});
+  pool_container c2{pool_allocator<element>(other_pool)};
+  mass_insert(c2, {4, 5});
+
+  c2 = std::move(c);
+  EXPECT_EQ(pool_allocator<element>(pool), c2.get_allocator());
+  expect_eq(c2, {1, 2, 3});
+  expect_empty(c);
+}
+
+TEST_F(correctness_test, move_ctor_allocator) {
+  node_pool pool;
+  node_pool other_pool;
+
+  pool_container c{pool_allocator<element>(pool)};
+  mass_insert(c, {1, 2, 3});
+  const element* first = &*c.begin();
+
+  pool_container c2(std::move(c), pool_allocator<element>(pool));
+  EXPECT_EQ(first, &*c2.begin());
+  expect_empty(c);
+
+  pool_container c3(std::move(c2), pool_allocator<element>(other_pool));
+  EXPECT_EQ(pool_allocator<element>(other_pool), c3.get_allocator());
+  expect_eq(c3, {1, 2, 3});
+  expect_empty(c2);
+}
+
+TEST_F(correctness_test, insert_rvalue) {
+  set<std::string> c;
+  std::string s(100, 'a');
+  const char* data = s.data();
+
+  auto [it, ins] = c.insert(std::move(s));
+  EXPECT_TRUE(ins);
+  EXPECT_EQ(data, it->data());
+
+  std::string s2(100, 'a');
+  auto [it2, ins2] = c.insert(std::move(s2));
+  EXPECT_FALSE(ins2);
+  EXPECT_EQ(it, it2);
+  EXPECT_EQ(std::string(100, 'a'), s2);
+
+  std::string s3(100, 'b');
+  data = s3.data();
+  it = c.insert(c.end(), std::move(s3));
+  EXPECT_EQ(data, it->data());
+}
+
+TEST_F(correctness_test, emplace) {
+  container c;
+  mass_insert(c, {1, 3, 5});
+
+  element present = 3;
+  element absent = 4;
+
+  size_t created = element::created_instances();
+  auto [it, ins] = c.emplace(present);
+  EXPECT_EQ(created, element::created_instances());
+  EXPECT_FALSE(ins);
+  EXPECT_EQ(c.find(3), it);
+
+  created = element::created_instances();
+  std::tie(it, ins) = c.emplace(absent);
+  EXPECT_EQ(created + 1, element::created_instances());
+  EXPECT_TRUE(ins);
+  EXPECT_EQ(4, *it);
+
+  std::tie(it, ins) = c.emplace(7);
+  EXPECT_TRUE(ins);
+  EXPECT_EQ(7, *it);
+  expect_eq(c, {1, 3, 4, 5, 7});
+}
+
+TEST_F(correctness_test, emplace_string) {
+  set<std::string> c;
+  auto [it, ins] = c.emplace(5, 'x');
+  EXPECT_TRUE(ins);
+  EXPECT_EQ("xxxxx", *it);
+
+  std::tie(it, ins) = c.emplace("xxxxx");
+  EXPECT_FALSE(ins);
+  EXPECT_EQ(c.begin(), it);
+  EXPECT_EQ(1, c.size());
+}
+
 TEST_F(correctness_test, copy_assignment) {
   container c;
   mass_insert(c, {1, 2, 3, 4});
@@ -195,6 +577,62 @@ TEST_F(correctness_test, copy_assignment_empty) {
   expect_empty(c2);
 }
 
+TEST_F(correctness_test, copy_assignment_reuses_nodes) {
+  set<int> c, c2;
+  for (int i = 0; i < 100; ++i) {
+    c.insert(i);
+  }
+  for (int i = 0; i < 50; ++i) {
+    c2.insert(i * 3 + 1'000);
+  }
+
+  size_t allocations = allocations_made();
+  c = c2;
+  EXPECT_EQ(allocations, allocations_made());
+  EXPECT_EQ(50, c.size());
+  EXPECT_TRUE(std::equal(c.begin(), c.end(), c2.begin(), c2.end()));
+  EXPECT_TRUE(std::equal(c.rbegin(), c.rend(), c2.rbegin(), c2.rend()));
+
+  set<int> c3;
+  for (int i = 0; i < 80; ++i) {
+    c3.insert(-i);
+  }
+  allocations = allocations_made();
+  c = c3;
+  EXPECT_EQ(allocations + 30, allocations_made());
+  EXPECT_TRUE(std::equal(c.begin(), c.end(), c3.begin(), c3.end()));
+  c.insert(5);
+  EXPECT_EQ(5, *std::prev(c.end()));
+}
+
+TEST_F(correctness_test, copy_assignment_reuses_nodes_with_policy_data) {
+  set<int, std::less<int>, std::allocator<int>, with_order_statistics<>> c, c2;
+  set<int, std::less<int>, std::allocator<int>, with_in_order_links<>> t, t2;
+  for (int i = 0; i < 300; ++i) {
+    c.insert(i);
+    t.insert(i);
+  }
+  for (int i = 0; i < 100; ++i) {
+    c2.insert(i * 2);
+    t2.insert(i * 2);
+  }
+
+  c = c2;
+  EXPECT_EQ(42, *c.nth(21));
+  EXPECT_EQ(21, c.rank(42));
+  c2 = c;
+  c2.insert(1);
+  EXPECT_EQ(2, *c2.nth(2));
+
+  t = t2;
+  EXPECT_TRUE(std::equal(t.begin(), t.end(), t2.begin(), t2.end()));
+  EXPECT_TRUE(std::equal(t.rbegin(), t.rend(), t2.rbegin(), t2.rend()));
+  t2.insert(-1);
+  t = t2;
+  EXPECT_EQ(-1, *t.begin());
+  EXPECT_EQ(101, std::distance(t.begin(), t.end()));
+}
+
 TEST_F(correctness_test, copy_assignment_self) {
   container c;
   mass_insert(c, {1, 2, 3, 4});
@@ -866,109 +1304,1228 @@ TEST_F(correctness_test, upper_bounds) {
   EXPECT_EQ(std::next(c.begin(), 7), c.upper_bound(11));
 }
 
-TEST_F(exception_safety_test, non_throwing_default_ctor) {
-  faulty_run([] {
-    try {
-      container c;
-    } catch (...) {
-      fault_injection_disable dg;
-      ADD_FAILURE() << "default constructor should not throw";
-      throw;
+TEST_F(correctness_test, lower_bound_from) {
+  container c;
+  for (int i = 0; i < 100; ++i) {
+    c.insert(2 * i);
+  }
+  for (auto finger = c.begin();; ++finger) {
+    for (int key = -2; key < 202; ++key) {
+      ASSERT_EQ(c.lower_bound(key), c.lower_bound_from(finger, key));
+      ASSERT_EQ(c.find(key), c.find_from(finger, key));
     }
-  });
+    if (finger == c.end()) {
+      break;
+    }
+  }
+
+  container empty;
+  EXPECT_EQ(empty.end(), empty.lower_bound_from(empty.end(), 1));
+  EXPECT_EQ(empty.end(), empty.find_from(empty.begin(), 1));
 }
 
-TEST_F(exception_safety_test, copy_ctor) {
-  faulty_run([] {
-    container c;
-    mass_insert(c, {3, 2, 4, 1});
+TEST_F(correctness_test, lower_bound_from_transparent_splay) {
+  set<element, std::less<>, std::allocator<element>, splay_tree_policy> c;
+  mass_insert(c, {5, 2, 8, 1, 3, 9, 7, 4, 6});
 
-    container c2 = c;
-    expect_eq(c, {1, 2, 3, 4});
-  });
+  size_t created = element::created_instances();
+  auto it = c.find_from(c.begin(), 3);
+  EXPECT_EQ(3, *it);
+  EXPECT_EQ(8, *c.find_from(it, 8));
+  EXPECT_EQ(c.end(), c.find_from(it, 10));
+  EXPECT_EQ(1, *c.lower_bound_from(c.end(), 0));
+  EXPECT_EQ(created, element::created_instances());
+  expect_eq(c, {1, 2, 3, 4, 5, 6, 7, 8, 9});
 }
 
-TEST_F(exception_safety_test, non_throwing_clear) {
-  faulty_run([] {
-    container c;
-    mass_insert(c, {3, 2, 4, 1});
-    try {
-      c.clear();
-    } catch (...) {
-      fault_injection_disable dg;
-      ADD_FAILURE() << "clear() should not throw";
-      throw;
-    }
-  });
-}
+TEST_F(correctness_test, pool_allocator) {
+  node_pool pool;
+  pool_container c{pool_allocator<element>(pool)};
+  mass_insert(c, {5, 3, 8, 1, 2});
+  EXPECT_EQ(pool_allocator<element>(pool), c.get_allocator());
 
-TEST_F(exception_safety_test, copy_assignment) {
-  faulty_run([] {
-    container c;
-    mass_insert(c, {3, 2, 4, 1});
+  const element* erased = &*c.find(3);
+  c.erase(3);
+  c.insert(42);
+  EXPECT_EQ(erased, &*c.find(42));
+  expect_eq(c, {1, 2, 5, 8, 42});
+}
 
-    container c2;
-    mass_insert(c2, {8, 7, 2, 14});
+TEST_F(correctness_test, pool_allocator_clear_reuses_nodes) {
+  static_assert(set_detail::deallocates_in_bulk<pool_allocator<int>, int>);
+  node_pool pool;
+  set<int, std::less<int>, pool_allocator<int>> c{pool_allocator<int>(pool)};
+  std::vector<const int*> addresses;
+  for (int i = 0; i < 1'000; ++i) {
+    addresses.push_back(&*c.insert(i).first);
+  }
+  c.clear();
 
-    strong_exception_safety_guard sg(c);
-    c = c2;
-    expect_eq(c, {2, 7, 8, 14});
-  });
+  size_t allocations = allocations_made();
+  for (int i = 0; i < 1'000; ++i) {
+    c.insert(i);
+  }
+  EXPECT_EQ(allocations, allocations_made());
+  std::vector<const int*> reused;
+  for (const int& x : c) {
+    reused.push_back(&x);
+  }
+  std::sort(addresses.begin(), addresses.end());
+  std::sort(reused.begin(), reused.end());
+  EXPECT_EQ(addresses, reused);
 }
 
-TEST_F(exception_safety_test, insert) {
-  faulty_run([] {
-    container c;
-    mass_insert(c, {3, 2, 4, 1});
+TEST_F(correctness_test, pool_allocator_over_aligned) {
+  struct alignas(256) over_aligned {
+    int value;
 
-    strong_exception_safety_guard sg(c);
-    c.insert(5);
-    expect_eq(c, {1, 2, 3, 4, 5});
-  });
+    bool operator<(const over_aligned& other) const {
+      return value < other.value;
+    }
+  };
+
+  node_pool pool;
+  pool_container small{pool_allocator<element>(pool)};
+  mass_insert(small, {1, 2, 3});
+  set<over_aligned, std::less<over_aligned>, pool_allocator<over_aligned>> c{pool_allocator<over_aligned>(pool)};
+  for (int i = 0; i < 50; ++i) {
+    c.insert({i});
+  }
+  for (const over_aligned& x : c) {
+    EXPECT_EQ(0, reinterpret_cast<std::uintptr_t>(&x) % alignof(over_aligned));
+  }
+  c.erase({25});
+  EXPECT_EQ(49, c.size());
+  expect_eq(small, {1, 2, 3});
 }
 
-TEST_F(exception_safety_test, erase_1) {
-  faulty_run([] {
-    container c;
-    mass_insert(c, {6, 3, 8, 2, 5, 7, 10});
+TEST_F(correctness_test, pool_allocator_copy) {
+  node_pool pool;
+  node_pool other_pool;
+  pool_container c{pool_allocator<element>(pool)};
+  mass_insert(c, {5, 3, 8, 1, 2});
 
-    strong_exception_safety_guard sg(c);
-    element val = 6;
-    c.erase(c.find(val));
-    expect_eq(c, {2, 3, 5, 7, 8, 10});
-  });
-}
+  pool_container c2 = c;
+  EXPECT_EQ(c.get_allocator(), c2.get_allocator());
+  expect_eq(c2, {1, 2, 3, 5, 8});
 
-TEST_F(exception_safety_test, erase_2) {
-  faulty_run([] {
-    container c;
-    mass_insert(c, {6, 3, 8, 2, 5, 7, 10});
+  pool_container c3{pool_allocator<element>(other_pool)};
+  c3.insert(7);
+  c3 = c;
+  EXPECT_EQ(pool_allocator<element>(other_pool), c3.get_allocator());
+  expect_eq(c3, {1, 2, 3, 5, 8});
 
-    strong_exception_safety_guard sg(c);
-    element val = 5;
-    c.erase(c.find(val));
-    expect_eq(c, {2, 3, 6, 7, 8, 10});
-  });
+  swap(c2, c3);
+  EXPECT_EQ(pool_allocator<element>(other_pool), c2.get_allocator());
+  EXPECT_EQ(pool_allocator<element>(pool), c3.get_allocator());
 }
 
-TEST_F(performance_test, size) {
-  constexpr size_t N = 100'000;
-  constexpr size_t K = 1'000'000;
+TEST_F(correctness_test, transparent_lookup) {
+  transparent_container c;
+  mass_insert(c, {8, 3, 5, 4, 3, 1, 8, 8, 10, 9});
 
-  container c;
-  mass_insert_balanced(c, N);
+  size_t created = element::created_instances();
+  EXPECT_EQ(c.end(), c.find(2));
+  EXPECT_EQ(std::next(c.begin(), 1), c.find(3));
+  EXPECT_EQ(std::next(c.begin(), 4), c.lower_bound(6));
+  EXPECT_EQ(std::next(c.begin(), 4), c.lower_bound(8));
+  EXPECT_EQ(std::next(c.begin(), 5), c.upper_bound(8));
+  EXPECT_EQ(c.end(), c.upper_bound(10));
+  EXPECT_EQ(created, element::created_instances());
 
-  for (size_t i = 0; i < K; ++i) {
-    EXPECT_EQ(N, c.size());
-  }
+  EXPECT_EQ(1, c.erase(5));
+  EXPECT_EQ(0, c.erase(5));
+  EXPECT_EQ(created, element::created_instances());
+  expect_eq(c, {1, 3, 4, 8, 9, 10});
+
+  transparent_container::iterator it = c.erase(c.find(3));
+  EXPECT_EQ(4, *it);
+  expect_eq(c, {1, 4, 8, 9, 10});
 }
 
-TEST_F(performance_test, iteration) {
-  constexpr size_t N = 100'000;
-  constexpr size_t K = 5;
+TEST_F(correctness_test, transparent_emplace) {
+  transparent_container c;
+  mass_insert(c, {1, 3, 5});
 
-  container c;
-  mass_insert_balanced(c, N);
+  size_t created = element::created_instances();
+  auto [it, ins] = c.emplace(3);
+  EXPECT_FALSE(ins);
+  EXPECT_EQ(created, element::created_instances());
+
+  std::tie(it, ins) = c.emplace(4);
+  EXPECT_TRUE(ins);
+  EXPECT_EQ(created + 1, element::created_instances());
+  EXPECT_EQ(4, *it);
+}
+
+TEST_F(correctness_test, transparent_string_lookup) {
+  set<std::string, std::less<>> c;
+  c.insert("abc");
+  c.insert("def");
+
+  EXPECT_EQ(c.begin(), c.find("abc"));
+  EXPECT_EQ(c.end(), c.find(std::string_view("xyz")));
+  EXPECT_EQ(1, c.erase("def"));
+  EXPECT_EQ(1, c.size());
+}
+
+TEST_F(correctness_test, nth) {
+  order_statistics_container c;
+  mass_insert(c, {8, 3, 5, 4, 1, 10, 9});
+
+  for (size_t i = 0; i < c.size(); ++i) {
+    EXPECT_EQ(std::next(c.begin(), static_cast<std::ptrdiff_t>(i)), c.nth(i));
+  }
+  EXPECT_EQ(c.end(), c.nth(c.size()));
+  EXPECT_EQ(c.end(), c.nth(100));
+
+  c.erase(5);
+  EXPECT_EQ(8, *c.nth(3));
+  c.insert(7);
+  EXPECT_EQ(7, *c.nth(3));
+}
+
+TEST_F(correctness_test, rank) {
+  order_statistics_container c;
+  mass_insert(c, {8, 3, 5, 4, 1, 10, 9});
+
+  EXPECT_EQ(0, c.rank(0));
+  EXPECT_EQ(0, c.rank(1));
+  EXPECT_EQ(1, c.rank(2));
+  EXPECT_EQ(4, c.rank(6));
+  EXPECT_EQ(4, c.rank(8));
+  EXPECT_EQ(7, c.rank(11));
+
+  EXPECT_EQ(3, c.count_in_range(3, 8));
+  EXPECT_EQ(4, c.count_in_range(3, 9));
+  EXPECT_EQ(0, c.count_in_range(6, 8));
+  EXPECT_EQ(0, c.count_in_range(9, 3));
+  EXPECT_EQ(7, c.count_in_range(0, 100));
+}
+
+TEST_F(correctness_test, order_statistics_distance) {
+  order_statistics_container c;
+  mass_insert(c, {8, 3, 5, 4, 1, 10, 9});
+
+  EXPECT_EQ(0, c.index_of(c.begin()));
+  EXPECT_EQ(3, c.index_of(c.find(5)));
+  EXPECT_EQ(7, c.index_of(c.end()));
+
+  EXPECT_EQ(7, c.distance(c.begin(), c.end()));
+  EXPECT_EQ(3, c.distance(c.find(4), c.find(9)));
+  EXPECT_EQ(-3, c.distance(c.find(9), c.find(4)));
+  EXPECT_EQ(0, c.distance(c.end(), c.end()));
+}
+
+TEST_F(correctness_test, order_statistics_copy_swap) {
+  std::vector<element> v = {1, 2, 3, 4, 5, 6, 7, 8};
+  order_statistics_container c(v.begin(), v.end());
+  EXPECT_EQ(5, *c.nth(4));
+
+  order_statistics_container c2 = c;
+  c2.erase(1);
+  EXPECT_EQ(6, *c2.nth(4));
+
+  order_statistics_container c3;
+  mass_insert(c3, {10, 20});
+  swap(c, c3);
+  EXPECT_EQ(20, *c.nth(1));
+  EXPECT_EQ(8, *c3.nth(7));
+  EXPECT_EQ(5, c3.rank(6));
+}
+
+TEST_F(correctness_test, order_statistics_unbalanced) {
+  set<int, std::less<int>, std::allocator<int>, with_order_statistics<unbalanced_tree_policy>> c;
+  for (int i : {5, 2, 8, 1, 3, 9, 7}) {
+    c.insert(i);
+  }
+  c.erase(5);
+  EXPECT_EQ(7, *c.nth(3));
+  EXPECT_EQ(4, c.rank(8));
+  EXPECT_EQ(6, c.distance(c.begin(), c.end()));
+}
+
+TEST_F(correctness_test, order_statistics_splay) {
+  set<int, std::less<int>, std::allocator<int>, with_order_statistics<splay_tree_policy>> c;
+  for (int i : {5, 2, 8, 1, 3, 9, 7}) {
+    c.insert(i);
+  }
+  EXPECT_EQ(9, *c.find(9));
+  EXPECT_EQ(2, *c.lower_bound(2));
+  c.erase(5);
+  EXPECT_EQ(7, *c.nth(3));
+  EXPECT_EQ(4, c.rank(8));
+  EXPECT_EQ(6, c.distance(c.begin(), c.end()));
+}
+
+TEST_F(correctness_test, order_statistics_treap) {
+  set<int, std::less<int>, std::allocator<int>, with_order_statistics<treap_policy<>>> c;
+  for (int i : {5, 2, 8, 1, 3, 9, 7}) {
+    c.insert(i);
+  }
+  c.erase(5);
+  EXPECT_EQ(7, *c.nth(3));
+  EXPECT_EQ(4, c.rank(8));
+  EXPECT_EQ(6, c.distance(c.begin(), c.end()));
+}
+
+TEST_F(correctness_test, order_statistics_scapegoat) {
+  set<int, std::less<int>, std::allocator<int>, with_order_statistics<scapegoat_tree_policy>> c;
+  for (int i = 0; i < 100; ++i) {
+    c.insert(i);
+  }
+  for (int i = 0; i < 100; i += 2) {
+    c.erase(i);
+  }
+  EXPECT_EQ(7, *c.nth(3));
+  EXPECT_EQ(4, c.rank(9));
+  EXPECT_EQ(50, c.distance(c.begin(), c.end()));
+}
+
+TEST_F(correctness_test, scapegoat_ascending_keeps_iterators) {
+  scapegoat_container c;
+  std::vector<scapegoat_container::const_iterator> its;
+  for (int i = 0; i < 1'000; ++i) {
+    its.push_back(c.insert(i).first);
+  }
+  for (int i = 0; i < 1'000; i += 3) {
+    c.erase(i);
+  }
+  for (int i = 0; i < 1'000; ++i) {
+    if (i % 3 != 0) {
+      ASSERT_EQ(its[i], c.find(i));
+    }
+  }
+  EXPECT_EQ(666, c.size());
+}
+
+TEST_F(correctness_test, splay_lookups_keep_iterators) {
+  splay_container c;
+  mass_insert(c, {5, 2, 8, 1, 3, 9, 7, 4, 6});
+  std::vector<splay_container::const_iterator> its;
+  for (auto it = c.begin(); it != c.end(); ++it) {
+    its.push_back(it);
+  }
+
+  EXPECT_EQ(its[8], c.find(9));
+  EXPECT_EQ(its[0], c.lower_bound(0));
+  EXPECT_EQ(c.end(), c.upper_bound(9));
+  EXPECT_EQ(c.end(), c.find(10));
+  EXPECT_EQ(its[4], c.find(5));
+  EXPECT_EQ(its[6], c.upper_bound(6));
+
+  for (int i = 0; i < 9; ++i) {
+    EXPECT_EQ(i + 1, *its[static_cast<size_t>(i)]);
+  }
+  expect_eq(c, {1, 2, 3, 4, 5, 6, 7, 8, 9});
+  expect_eq(reverse_view(c), {9, 8, 7, 6, 5, 4, 3, 2, 1});
+}
+
+TEST_F(correctness_test, split) {
+  container c;
+  mass_insert(c, {6, 3, 8, 2, 5, 7, 10, 1, 4, 9});
+  auto it = c.find(7);
+
+  auto [l, r] = c.split(5);
+  EXPECT_TRUE(c.empty());
+  expect_eq(l, {1, 2, 3, 4});
+  expect_eq(r, {5, 6, 7, 8, 9, 10});
+  EXPECT_EQ(4, l.size());
+  EXPECT_EQ(6, r.size());
+  EXPECT_EQ(it, r.find(7));
+
+  r.insert(0);
+  l.erase(2);
+  expect_eq(l, {1, 3, 4});
+  expect_eq(r, {0, 5, 6, 7, 8, 9, 10});
+}
+
+TEST_F(correctness_test, split_absent_key) {
+  container c;
+  mass_insert(c, {2, 4, 6, 8});
+
+  auto [l, r] = c.split(5);
+  expect_eq(l, {2, 4});
+  expect_eq(r, {6, 8});
+}
+
+TEST_F(correctness_test, split_ends) {
+  container c;
+  mass_insert(c, {2, 4, 6});
+
+  auto [l1, r1] = c.split(1);
+  EXPECT_TRUE(l1.empty());
+  expect_eq(r1, {2, 4, 6});
+
+  auto [l2, r2] = r1.split(7);
+  expect_eq(l2, {2, 4, 6});
+  EXPECT_TRUE(r2.empty());
+
+  container empty;
+  auto [l3, r3] = empty.split(1);
+  EXPECT_TRUE(l3.empty());
+  EXPECT_TRUE(r3.empty());
+}
+
+TEST_F(correctness_test, join) {
+  container l, r;
+  mass_insert(l, {3, 1, 2});
+  mass_insert(r, {7, 5, 6, 4, 8, 9});
+  auto it = l.find(3);
+
+  container c = join(std::move(l), std::move(r));
+  EXPECT_TRUE(l.empty());
+  EXPECT_TRUE(r.empty());
+  expect_eq(c, {1, 2, 3, 4, 5, 6, 7, 8, 9});
+  EXPECT_EQ(9, c.size());
+  EXPECT_EQ(it, c.find(3));
+
+  c.erase(3);
+  c.insert(10);
+  expect_eq(c, {1, 2, 4, 5, 6, 7, 8, 9, 10});
+}
+
+TEST_F(correctness_test, join_empty) {
+  container l, r;
+  mass_insert(l, {1, 2});
+
+  container c1 = join(std::move(l), container());
+  expect_eq(c1, {1, 2});
+
+  container c2 = join(container(), std::move(c1));
+  expect_eq(c2, {1, 2});
+
+  container c3 = join(container(), container());
+  EXPECT_TRUE(c3.empty());
+}
+
+TEST_F(correctness_test, split_join_no_copies) {
+  container c;
+  mass_insert_balanced(c, 1000);
+  element key = 300;
+  size_t created = element::created_instances();
+
+  auto [l, r] = c.split(key);
+  container joined = join(std::move(l), std::move(r));
+  EXPECT_EQ(created, element::created_instances());
+  EXPECT_EQ(1000, joined.size());
+}
+
+TEST_F(correctness_test, split_join_order_statistics) {
+  std::vector<int> v(100);
+  std::iota(v.begin(), v.end(), 0);
+  set<int, std::less<int>, std::allocator<int>, with_order_statistics<>> c(v.begin(), v.end());
+
+  auto [l, r] = c.split(37);
+  EXPECT_EQ(37, l.size());
+  EXPECT_EQ(63, r.size());
+  EXPECT_EQ(36, *l.nth(36));
+  EXPECT_EQ(37, *r.nth(0));
+  EXPECT_EQ(10, r.rank(47));
+
+  auto joined = join(std::move(r), decltype(c)());
+  joined = join(std::move(l), std::move(joined));
+  EXPECT_EQ(50, *joined.nth(50));
+  EXPECT_EQ(99, joined.rank(99));
+}
+
+TEST_F(correctness_test, rebalance_ascending) {
+  unbalanced_container c;
+  EXPECT_EQ(0, c.height());
+  c.rebalance();
+  expect_empty(c);
+
+  std::vector<unbalanced_container::const_iterator> its;
+  for (int i = 0; i < 1'000; ++i) {
+    its.push_back(c.insert(c.end(), i));
+  }
+  EXPECT_EQ(1'000, c.height());
+
+  size_t created = element::created_instances();
+  c.rebalance();
+  EXPECT_EQ(created, element::created_instances());
+  EXPECT_EQ(10, c.height());
+  for (int i = 0; i < 1'000; ++i) {
+    ASSERT_EQ(its[i], c.find(i));
+  }
+  EXPECT_EQ(its.front(), c.begin());
+  EXPECT_EQ(its.back(), std::prev(c.end()));
+
+  c.erase(500);
+  c.insert(-1);
+  EXPECT_EQ(1'000, c.size());
+  EXPECT_EQ(-1, *c.begin());
+  EXPECT_EQ(c.end(), c.find(500));
+}
+
+TEST_F(correctness_test, rebalance_keeps_policy_invariants) {
+  auto check = [&]<typename C>(C c) {
+    std::mt19937 rng(1350);
+    std::uniform_int_distribution value_dist(0, 2'000);
+    std::set<int> expected;
+    for (int i = 0; i < 1'000; ++i) {
+      int e = value_dist(rng);
+      c.insert(e);
+      expected.insert(e);
+    }
+    c.rebalance();
+    EXPECT_EQ(std::bit_width(c.size()), c.height());
+    for (int i = 0; i < 2'000; ++i) {
+      int e = value_dist(rng);
+      if (i % 2 == 0) {
+        ASSERT_EQ(expected.insert(e).second, c.insert(e).second);
+      } else {
+        ASSERT_EQ(expected.erase(e), c.erase(e));
+      }
+    }
+    EXPECT_TRUE(std::equal(c.begin(), c.end(), expected.begin(), expected.end()));
+    EXPECT_LE(c.height(), 3 * std::bit_width(c.size()));
+    if constexpr (requires { c.nth(0); }) {
+      EXPECT_EQ(*std::next(expected.begin(), 100), *c.nth(100));
+    }
+  };
+  check(set<int>());
+  check(set<int, std::less<int>, std::allocator<int>, with_order_statistics<>>());
+  check(set<int, std::less<int>, std::allocator<int>, with_order_statistics<with_in_order_links<>>>());
+  check(set<int, std::less<int>, std::allocator<int>, scapegoat_tree_policy>());
+  check(set<int, std::less<int>, std::allocator<int>, treap_policy<>>());
+}
+
+TEST_F(correctness_test, split_join_unbalanced) {
+  set<int, std::less<int>, std::allocator<int>, unbalanced_tree_policy> c;
+  for (int i : {5, 2, 8, 1, 3, 9, 7, 4, 6}) {
+    c.insert(i);
+  }
+
+  auto [l, r] = c.split(6);
+  expect_eq(l, {1, 2, 3, 4, 5});
+  expect_eq(r, {6, 7, 8, 9});
+
+  auto joined = join(std::move(l), std::move(r));
+  expect_eq(joined, {1, 2, 3, 4, 5, 6, 7, 8, 9});
+}
+
+TEST_F(correctness_test, split_join_splay) {
+  using splay_set = set<int, std::less<int>, std::allocator<int>, splay_tree_policy>;
+  splay_set c;
+  for (int i : {5, 2, 8, 1, 3, 9, 7, 4, 6}) {
+    c.insert(i);
+  }
+
+  auto [l, r] = c.split(6);
+  expect_eq(l, {1, 2, 3, 4, 5});
+  expect_eq(r, {6, 7, 8, 9});
+
+  auto joined = join(std::move(l), std::move(r));
+  expect_eq(joined, {1, 2, 3, 4, 5, 6, 7, 8, 9});
+  EXPECT_EQ(1, joined.erase(4));
+  std::vector<int> other = {0, 3, 10};
+  expect_eq(set_union(std::move(joined), splay_set(other.begin(), other.end())), {0, 1, 2, 3, 5, 6, 7, 8, 9, 10});
+}
+
+TEST_F(correctness_test, split_join_treap) {
+  treap_container c;
+  mass_insert(c, {5, 2, 8, 1, 3, 9, 7, 4, 6});
+  auto it = c.find(7);
+
+  auto [l, r] = c.split(6);
+  expect_eq(l, {1, 2, 3, 4, 5});
+  expect_eq(r, {6, 7, 8, 9});
+  EXPECT_EQ(it, r.find(7));
+
+  treap_container joined = join(std::move(l), std::move(r));
+  expect_eq(joined, {1, 2, 3, 4, 5, 6, 7, 8, 9});
+  joined.erase(4);
+  joined.insert(10);
+  expect_eq(joined, {1, 2, 3, 5, 6, 7, 8, 9, 10});
+}
+
+TEST_F(correctness_test, split_join_scapegoat) {
+  scapegoat_container c;
+  mass_insert(c, {5, 2, 8, 1, 3, 9, 7, 4, 6});
+  auto it = c.find(7);
+
+  auto [l, r] = c.split(6);
+  expect_eq(l, {1, 2, 3, 4, 5});
+  expect_eq(r, {6, 7, 8, 9});
+  EXPECT_EQ(it, r.find(7));
+
+  scapegoat_container joined = join(std::move(l), std::move(r));
+  expect_eq(joined, {1, 2, 3, 4, 5, 6, 7, 8, 9});
+  joined.erase(4);
+  joined.insert(10);
+  expect_eq(joined, {1, 2, 3, 5, 6, 7, 8, 9, 10});
+}
+
+TEST_F(correctness_test, scapegoat_height_bound) {
+  auto height_bound = [](size_t n) {
+    return static_cast<size_t>(std::log(static_cast<double>(n)) / std::log(1.5)) + 1;
+  };
+
+  set<int, std::less<int>, std::allocator<int>, scapegoat_tree_policy> c;
+  std::mt19937 rng(1351);
+  std::uniform_int_distribution value_dist(0, 100'000);
+  for (int i = 0; i < 100'000; ++i) {
+    c.insert(i % 3 == 0 ? i : value_dist(rng));
+    if (i % 4 == 0) {
+      c.erase(value_dist(rng));
+    }
+    if (i % 1'000 == 0) {
+      ASSERT_LE(c.height(), height_bound(c.size()));
+    }
+  }
+
+  // Split and join leave the height to the caller, rebalance() brings it back within the bound.
+  for (int i = 0; i < 20; ++i) {
+    auto [l, r] = c.split(value_dist(rng));
+    c = join(std::move(l), std::move(r));
+  }
+  c.rebalance();
+  EXPECT_LE(c.height(), height_bound(c.size()));
+  for (int i = 0; i < 10'000; ++i) {
+    c.erase(value_dist(rng));
+    c.insert(value_dist(rng));
+  }
+  EXPECT_LE(c.height(), height_bound(c.size()));
+}
+
+TEST_F(correctness_test, set_union) {
+  container a, b;
+  mass_insert(a, {1, 3, 5, 7, 9});
+  mass_insert(b, {2, 3, 4, 9, 10});
+  auto it = a.find(3);
+
+  container c = set_union(std::move(a), std::move(b));
+  EXPECT_TRUE(a.empty());
+  EXPECT_TRUE(b.empty());
+  expect_eq(c, {1, 2, 3, 4, 5, 7, 9, 10});
+  EXPECT_EQ(8, c.size());
+  EXPECT_EQ(it, c.find(3));
+}
+
+TEST_F(correctness_test, set_intersection) {
+  container a, b;
+  mass_insert(a, {1, 3, 5, 7, 9});
+  mass_insert(b, {2, 3, 4, 9, 10});
+  auto it = a.find(9);
+
+  container c = set_intersection(std::move(a), std::move(b));
+  EXPECT_TRUE(a.empty());
+  EXPECT_TRUE(b.empty());
+  expect_eq(c, {3, 9});
+  EXPECT_EQ(2, c.size());
+  EXPECT_EQ(it, c.find(9));
+}
+
+TEST_F(correctness_test, set_difference) {
+  container a, b;
+  mass_insert(a, {1, 3, 5, 7, 9});
+  mass_insert(b, {2, 3, 4, 9, 10});
+
+  container c = set_difference(std::move(a), std::move(b));
+  EXPECT_TRUE(a.empty());
+  EXPECT_TRUE(b.empty());
+  expect_eq(c, {1, 5, 7});
+  EXPECT_EQ(3, c.size());
+}
+
+TEST_F(correctness_test, set_operations_empty) {
+  container a;
+  mass_insert(a, {1, 2});
+
+  expect_eq(set_union(container(), container(a)), {1, 2});
+  expect_eq(set_union(container(a), container()), {1, 2});
+  EXPECT_TRUE(set_intersection(container(a), container()).empty());
+  EXPECT_TRUE(set_intersection(container(), container(a)).empty());
+  expect_eq(set_difference(container(a), container()), {1, 2});
+  EXPECT_TRUE(set_difference(container(), container(a)).empty());
+}
+
+TEST_F(correctness_test, set_operations_order_statistics) {
+  using order_statistics_set = set<int, std::less<int>, std::allocator<int>, with_order_statistics<>>;
+  std::vector<int> even, thirds;
+  for (int i = 0; i < 300; ++i) {
+    even.push_back(2 * i);
+    thirds.push_back(3 * i);
+  }
+
+  order_statistics_set c = set_intersection(order_statistics_set(even.begin(), even.end()),
+                                            order_statistics_set(thirds.begin(), thirds.end()));
+  EXPECT_EQ(100, c.size());
+  EXPECT_EQ(42, *c.nth(7));
+  EXPECT_EQ(7, c.rank(42));
+}
+
+TEST_F(correctness_test, parallel_set_operations) {
+  std::mt19937 rng(2024);
+  std::uniform_int_distribution value_dist(0, 1'000'000);
+  std::vector<int> a, b;
+  for (size_t i = 0; i < 200'000; ++i) {
+    a.push_back(value_dist(rng));
+    b.push_back(value_dist(rng));
+  }
+  std::sort(a.begin(), a.end());
+  a.erase(std::unique(a.begin(), a.end()), a.end());
+  std::sort(b.begin(), b.end());
+  b.erase(std::unique(b.begin(), b.end()), b.end());
+
+  std::vector<int> expected;
+  std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+  set<int> c = set_union(parallel, set<int>(a.begin(), a.end()), set<int>(b.begin(), b.end()));
+  EXPECT_EQ(expected.size(), c.size());
+  EXPECT_TRUE(std::equal(c.begin(), c.end(), expected.begin(), expected.end()));
+
+  expected.clear();
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+  c = set_intersection(parallel, set<int>(a.begin(), a.end()), set<int>(b.begin(), b.end()));
+  EXPECT_EQ(expected.size(), c.size());
+  EXPECT_TRUE(std::equal(c.begin(), c.end(), expected.begin(), expected.end()));
+
+  expected.clear();
+  std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+  c = set_difference(parallel, set<int>(a.begin(), a.end()), set<int>(b.begin(), b.end()));
+  EXPECT_EQ(expected.size(), c.size());
+  EXPECT_TRUE(std::equal(c.begin(), c.end(), expected.begin(), expected.end()));
+}
+
+TEST_F(correctness_test, extract) {
+  container c;
+  mass_insert(c, {6, 3, 8, 2, 5, 7, 10});
+  const element* address = &*c.find(5);
+
+  container::node_type nh = c.extract(c.find(5));
+  expect_eq(c, {2, 3, 6, 7, 8, 10});
+  ASSERT_FALSE(nh.empty());
+  EXPECT_EQ(5, nh.value());
+  EXPECT_EQ(address, &nh.value());
+
+  nh = c.extract(8);
+  expect_eq(c, {2, 3, 6, 7, 10});
+  EXPECT_EQ(8, nh.value());
+
+  EXPECT_TRUE(c.extract(42).empty());
+  EXPECT_EQ(5, c.size());
+}
+
+TEST_F(correctness_test, insert_node) {
+  container a, b;
+  mass_insert(a, {1, 2, 3});
+  mass_insert(b, {3, 4});
+  const element* address = &*a.find(2);
+
+  auto [it, inserted, node] = b.insert(a.extract(2));
+  EXPECT_TRUE(inserted);
+  EXPECT_TRUE(node.empty());
+  EXPECT_EQ(address, &*it);
+  expect_eq(a, {1, 3});
+  expect_eq(b, {2, 3, 4});
+
+  auto result = b.insert(a.extract(3));
+  EXPECT_FALSE(result.inserted);
+  EXPECT_EQ(b.find(3), result.position);
+  ASSERT_FALSE(result.node.empty());
+  EXPECT_EQ(3, result.node.value());
+  expect_eq(a, {1});
+
+  result.node.value() = 5;
+  auto it2 = b.insert(b.end(), std::move(result.node));
+  EXPECT_EQ(5, *it2);
+  expect_eq(b, {2, 3, 4, 5});
+
+  auto empty_result = b.insert(container::node_type());
+  EXPECT_FALSE(empty_result.inserted);
+  EXPECT_EQ(b.end(), empty_result.position);
+}
+
+TEST_F(correctness_test, insert_node_no_copies) {
+  container a, b;
+  mass_insert_balanced(a, 100);
+  mass_insert_balanced(b, 100, 3);
+  size_t created = element::created_instances();
+
+  for (auto it = a.begin(); it != a.end();) {
+    b.insert(a.extract(it++));
+  }
+  EXPECT_TRUE(a.empty());
+  EXPECT_EQ(created, element::created_instances());
+}
+
+TEST_F(correctness_test, merge) {
+  container a, b;
+  mass_insert(a, {1, 3, 5, 7});
+  mass_insert(b, {2, 3, 6, 7, 8});
+  const element* address = &*b.find(8);
+
+  a.merge(b);
+  expect_eq(a, {1, 2, 3, 5, 6, 7, 8});
+  expect_eq(b, {3, 7});
+  EXPECT_EQ(address, &*a.find(8));
+
+  a.merge(a);
+  EXPECT_EQ(7, a.size());
+
+  a.merge(container());
+  EXPECT_EQ(7, a.size());
+}
+
+TEST_F(correctness_test, transparent_extract) {
+  transparent_container c;
+  mass_insert(c, {1, 2, 3});
+  size_t created = element::created_instances();
+
+  auto nh = c.extract(2);
+  EXPECT_EQ(created, element::created_instances());
+  EXPECT_EQ(2, nh.value());
+  expect_eq(c, {1, 3});
+}
+
+TEST_F(correctness_test, order_statistics_merge) {
+  using order_statistics_set = set<int, std::less<int>, std::allocator<int>, with_order_statistics<>>;
+  order_statistics_set a, b;
+  for (int i = 0; i < 50; ++i) {
+    a.insert(2 * i);
+    b.insert(3 * i);
+  }
+
+  a.merge(b);
+  EXPECT_EQ(83, a.size());
+  EXPECT_EQ(17, b.size());
+  EXPECT_EQ(3, *a.nth(2));
+  EXPECT_EQ(3, b.rank(18));
+  a.insert(b.extract(b.begin()));
+  EXPECT_EQ(16, b.size());
+  EXPECT_EQ(6, *b.nth(0));
+}
+
+TEST_F(correctness_test, in_order_links) {
+  auto expect_links = [](const threaded_container& c, std::vector<int> expected) {
+    expect_eq(c, expected);
+    std::reverse(expected.begin(), expected.end());
+    expect_eq(reverse_view(c), expected);
+  };
+
+  threaded_container c;
+  mass_insert(c, {5, 2, 8, 1, 9});
+  c.insert(c.find(5), 4);
+  c.insert(c.end(), 10);
+  c.emplace(3);
+  expect_links(c, {1, 2, 3, 4, 5, 8, 9, 10});
+
+  c.erase(c.begin());
+  c.erase(std::prev(c.end()));
+  c.erase(5);
+  expect_links(c, {2, 3, 4, 8, 9});
+
+  auto nh = c.extract(4);
+  threaded_container other;
+  mass_insert(other, {6, 7});
+  other.insert(std::move(nh));
+  c.merge(other);
+  expect_links(c, {2, 3, 4, 6, 7, 8, 9});
+  expect_links(other, {});
+
+  auto [l, r] = c.split(6);
+  expect_links(l, {2, 3, 4});
+  expect_links(r, {6, 7, 8, 9});
+  c = join(std::move(l), std::move(r));
+  expect_links(c, {2, 3, 4, 6, 7, 8, 9});
+
+  threaded_container copy = c;
+  threaded_container moved = std::move(c);
+  expect_links(copy, {2, 3, 4, 6, 7, 8, 9});
+  expect_links(moved, {2, 3, 4, 6, 7, 8, 9});
+  expect_links(c, {});
+
+  other.insert(1);
+  swap(other, moved);
+  expect_links(other, {2, 3, 4, 6, 7, 8, 9});
+  expect_links(moved, {1});
+
+  threaded_container u = set_union(std::move(other), std::move(moved));
+  expect_links(u, {1, 2, 3, 4, 6, 7, 8, 9});
+
+  std::vector<int> sorted = {10, 20, 30};
+  u.assign(sorted.begin(), sorted.end());
+  expect_links(u, {10, 20, 30});
+  u.clear();
+  expect_links(u, {});
+  u.insert(1);
+  expect_links(u, {1});
+}
+
+TEST_F(correctness_test, find_many) {
+  container c;
+  mass_insert(c, {8, 3, 5, 4, 1, 10, 9});
+  std::vector<element> keys;
+  for (int i = 0; i < 40; ++i) {
+    keys.emplace_back(i % 12);
+  }
+
+  std::vector<container::const_iterator> found(keys.size());
+  std::vector<container::const_iterator> lower(keys.size());
+  c.find_many(keys, found);
+  c.lower_bound_many(keys, lower);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(c.find(keys[i]), found[i]);
+    EXPECT_EQ(c.lower_bound(keys[i]), lower[i]);
+  }
+}
+
+TEST_F(correctness_test, find_many_empty) {
+  container c;
+  std::vector<element> keys = {1, 2, 3};
+  std::vector<container::const_iterator> out(keys.size());
+  c.find_many(keys, out);
+  EXPECT_EQ(std::vector<container::const_iterator>(keys.size(), c.end()), out);
+
+  mass_insert(c, {1, 2});
+  c.lower_bound_many(std::span<const element>(), out);
+  EXPECT_EQ(c.end(), out[0]);
+}
+
+TEST_F(correctness_test, transparent_find_many) {
+  transparent_container c;
+  mass_insert(c, {1, 3, 5, 7});
+  std::vector<int> keys = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+  std::vector<transparent_container::const_iterator> out(keys.size());
+
+  size_t created = element::created_instances();
+  c.find_many(std::span<const int>(keys), out);
+  EXPECT_EQ(created, element::created_instances());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(c.find(keys[i]), out[i]);
+  }
+
+  c.lower_bound_many(std::span<const int>(keys), out);
+  EXPECT_EQ(created, element::created_instances());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(c.lower_bound(keys[i]), out[i]);
+  }
+}
+
+TEST_F(exception_safety_test, non_throwing_default_ctor) {
+  faulty_run([] {
+    try {
+      container c;
+    } catch (...) {
+      fault_injection_disable dg;
+      ADD_FAILURE() << "default constructor should not throw";
+      throw;
+    }
+  });
+}
+
+TEST_F(exception_safety_test, copy_ctor) {
+  faulty_run([] {
+    container c;
+    mass_insert(c, {3, 2, 4, 1});
+
+    container c2 = c;
+    expect_eq(c, {1, 2, 3, 4});
+  });
+}
+
+TEST_F(exception_safety_test, non_throwing_clear) {
+  faulty_run([] {
+    container c;
+    mass_insert(c, {3, 2, 4, 1});
+    try {
+      c.clear();
+    } catch (...) {
+      fault_injection_disable dg;
+      ADD_FAILURE() << "clear() should not throw";
+      throw;
+    }
+  });
+}
+
+TEST_F(exception_safety_test, copy_assignment) {
+  faulty_run([] {
+    container c;
+    mass_insert(c, {3, 2, 4, 1});
+
+    container c2;
+    mass_insert(c2, {8, 7, 2, 14});
+
+    strong_exception_safety_guard sg(c);
+    c = c2;
+    expect_eq(c, {2, 7, 8, 14});
+  });
+}
+
+TEST_F(exception_safety_test, copy_assignment_reuses_nodes) {
+  faulty_run([] {
+    set<int> c;
+    set<int> c2;
+    {
+      fault_injection_disable dg;
+      mass_insert(c, {3, 2, 4, 1});
+      mass_insert(c2, {8, 7, 2, 14, 9, 11, 0});
+    }
+
+    strong_exception_safety_guard sg(c);
+    c = c2;
+    expect_eq(c, {0, 2, 7, 8, 9, 11, 14});
+  });
+}
+
+TEST_F(exception_safety_test, range_ctor) {
+  faulty_run([] {
+    std::vector<element> v = {1, 2, 3, 4, 5, 6};
+    container c(v.begin(), v.end());
+    expect_eq(c, {1, 2, 3, 4, 5, 6});
+  });
+}
+
+TEST_F(exception_safety_test, assign) {
+  faulty_run([] {
+    container c;
+    mass_insert(c, {3, 2, 4, 1});
+
+    std::vector<element> v = {5, 6, 7};
+
+    strong_exception_safety_guard sg(c);
+    c.assign(v.begin(), v.end());
+    expect_eq(c, {5, 6, 7});
+  });
+}
+
+TEST_F(exception_safety_test, insert) {
+  faulty_run([] {
+    container c;
+    mass_insert(c, {3, 2, 4, 1});
+
+    strong_exception_safety_guard sg(c);
+    c.insert(5);
+    expect_eq(c, {1, 2, 3, 4, 5});
+  });
+}
+
+TEST_F(exception_safety_test, insert_hint) {
+  faulty_run([] {
+    container c;
+    mass_insert(c, {3, 2, 4, 1});
+
+    {
+      strong_exception_safety_guard sg(c);
+      c.insert(c.end(), 5);
+    }
+    strong_exception_safety_guard sg(c);
+    c.insert(c.find(3), 0);
+    expect_eq(c, {0, 1, 2, 3, 4, 5});
+  });
+}
+
+TEST_F(exception_safety_test, emplace_hint) {
+  faulty_run([] {
+    container c;
+    mass_insert(c, {3, 2, 4, 1});
+
+    strong_exception_safety_guard sg(c);
+    c.emplace_hint(c.find(3), 5);
+    expect_eq(c, {1, 2, 3, 4, 5});
+  });
+}
+
+TEST_F(exception_safety_test, non_throwing_move) {
+  faulty_run([] {
+    container c;
+    mass_insert(c, {3, 2, 4, 1});
+    try {
+      container c2 = std::move(c);
+      c = std::move(c2);
+    } catch (...) {
+      fault_injection_disable dg;
+      ADD_FAILURE() << "move operations should not throw";
+      throw;
+    }
+    expect_eq(c, {1, 2, 3, 4});
+  });
+}
+
+TEST_F(exception_safety_test, emplace) {
+  faulty_run([] {
+    container c;
+    mass_insert(c, {3, 2, 4, 1});
+
+    strong_exception_safety_guard sg(c);
+    c.emplace(5);
+    expect_eq(c, {1, 2, 3, 4, 5});
+  });
+}
+
+TEST_F(exception_safety_test, transparent_erase) {
+  faulty_run([] {
+    transparent_container c;
+    mass_insert(c, {6, 3, 8, 2, 5, 7, 10});
+
+    strong_exception_safety_guard sg(c);
+    c.erase(6);
+    expect_eq(c, {2, 3, 5, 7, 8, 10});
+  });
+}
+
+TEST_F(exception_safety_test, erase_1) {
+  faulty_run([] {
+    container c;
+    mass_insert(c, {6, 3, 8, 2, 5, 7, 10});
+
+    strong_exception_safety_guard sg(c);
+    element val = 6;
+    c.erase(c.find(val));
+    expect_eq(c, {2, 3, 5, 7, 8, 10});
+  });
+}
+
+TEST_F(exception_safety_test, erase_2) {
+  faulty_run([] {
+    container c;
+    mass_insert(c, {6, 3, 8, 2, 5, 7, 10});
+
+    strong_exception_safety_guard sg(c);
+    element val = 5;
+    c.erase(c.find(val));
+    expect_eq(c, {2, 3, 6, 7, 8, 10});
+  });
+}
+
+TEST_F(exception_safety_test, split) {
+  faulty_run([] {
+    container c;
+    mass_insert(c, {6, 3, 8, 2, 5, 7, 10});
+
+    strong_exception_safety_guard sg(c);
+    auto [l, r] = c.split(6);
+    fault_injection_disable dg;
+    expect_eq(l, {2, 3, 5});
+    expect_eq(r, {6, 7, 8, 10});
+  });
+}
+
+TEST_F(exception_safety_test, set_union) {
+  faulty_run([] {
+    container a, b;
+    mass_insert(a, {6, 3, 8, 2, 5});
+    mass_insert(b, {7, 3, 10, 1, 5});
+
+    try {
+      container c = set_union(std::move(a), std::move(b));
+      fault_injection_disable dg;
+      expect_eq(c, {1, 2, 3, 5, 6, 7, 8, 10});
+    } catch (...) {
+      fault_injection_disable dg;
+      EXPECT_TRUE(a.empty());
+      EXPECT_TRUE(b.empty());
+      throw;
+    }
+  });
+}
+
+TEST_F(exception_safety_test, set_difference) {
+  faulty_run([] {
+    container a, b;
+    mass_insert(a, {6, 3, 8, 2, 5});
+    mass_insert(b, {7, 3, 10, 1, 5});
+
+    try {
+      container c = set_difference(std::move(a), std::move(b));
+      fault_injection_disable dg;
+      expect_eq(c, {2, 6, 8});
+    } catch (...) {
+      fault_injection_disable dg;
+      EXPECT_TRUE(a.empty());
+      EXPECT_TRUE(b.empty());
+      throw;
+    }
+  });
+}
+
+TEST_F(exception_safety_test, insert_node) {
+  faulty_run([] {
+    container a, b;
+    mass_insert(a, {6, 3, 8});
+    mass_insert(b, {2, 5, 7, 10});
+
+    try {
+      strong_exception_safety_guard sg(b);
+      b.insert(a.extract(a.begin()));
+    } catch (const std::bad_alloc&) {
+      fault_injection_disable dg;
+      ADD_FAILURE() << "moving a node should not allocate";
+      throw;
+    }
+    fault_injection_disable dg;
+    expect_eq(a, {6, 8});
+    expect_eq(b, {2, 3, 5, 7, 10});
+  });
+}
+
+TEST_F(exception_safety_test, merge) {
+  faulty_run([] {
+    container a, b;
+    mass_insert(a, {6, 3, 8});
+    mass_insert(b, {2, 3, 7, 10});
+
+    try {
+      a.merge(b);
+    } catch (const std::bad_alloc&) {
+      fault_injection_disable dg;
+      ADD_FAILURE() << "merge should not allocate";
+      throw;
+    } catch (...) {
+      fault_injection_disable dg;
+      EXPECT_EQ(7, a.size() + b.size());
+      throw;
+    }
+    fault_injection_disable dg;
+    expect_eq(a, {2, 3, 6, 7, 8, 10});
+    expect_eq(b, {3});
+  });
+}
+
+TEST_F(exception_safety_test, pool_non_throwing_ctor) {
+  faulty_run([] {
+    node_pool pool;
+    try {
+      pool_container c{pool_allocator<element>(pool)};
+    } catch (...) {
+      fault_injection_disable dg;
+      ADD_FAILURE() << "constructor of an empty set should not throw";
+      throw;
+    }
+  });
+}
+
+TEST_F(exception_safety_test, pool_insert) {
+  faulty_run([] {
+    node_pool pool(2);
+    pool_container c{pool_allocator<element>(pool)};
+    mass_insert(c, {3, 2, 4, 1});
+
+    strong_exception_safety_guard sg(c);
+    c.insert(5);
+    expect_eq(c, {1, 2, 3, 4, 5});
+  });
+}
+
+TEST_F(performance_test, size) {
+  constexpr size_t N = 100'000;
+  constexpr size_t K = 1'000'000;
+
+  container c;
+  mass_insert_balanced(c, N);
+
+  for (size_t i = 0; i < K; ++i) {
+    EXPECT_EQ(N, c.size());
+  }
+}
+
+TEST_F(performance_test, iteration) {
+  constexpr size_t N = 100'000;
+  constexpr size_t K = 5;
+
+  container c;
+  mass_insert_balanced(c, N);
 
   for (size_t i = 0; i < K; ++i) {
     for (container::iterator j = c.begin(); j != c.end(); ++j) {
@@ -1006,6 +2563,329 @@ TEST_F(performance_test, swap) {
   }
 }
 
+TEST_F(performance_test, copy_assignment_allocations) {
+  constexpr int N = 200'000;
+  constexpr int K = 50;
+
+  std::vector<int> v(N);
+  std::iota(v.begin(), v.end(), 0);
+  set<int> current(v.begin(), v.end());
+  std::vector<set<int>> refreshed;
+  for (int i = 0; i < 2; ++i) {
+    std::transform(v.begin(), v.end(), v.begin(), [](int x) { return x + 1; });
+    refreshed.emplace_back(v.begin(), v.end());
+  }
+
+  size_t allocations = allocations_made();
+  for (int i = 0; i < K; ++i) {
+    current = refreshed[i % 2];
+  }
+  EXPECT_EQ(allocations, allocations_made());
+  EXPECT_TRUE(std::equal(current.begin(), current.end(), refreshed[1].begin(), refreshed[1].end()));
+}
+
+TEST_F(performance_test, copy_ctor_chain) {
+  // Deep enough to overflow the stack if the copy recursed along the chain.
+  constexpr int N = 1'000'000;
+
+  set<int, std::less<int>, std::allocator<int>, unbalanced_tree_policy> c;
+  for (int i = 0; i < N; ++i) {
+    c.insert(c.begin(), -i);
+  }
+
+  auto c2 = c;
+  EXPECT_EQ(N, c2.size());
+  EXPECT_EQ(N, c2.height());
+  EXPECT_EQ(-N + 1, *c2.begin());
+  EXPECT_EQ(0, *c2.rbegin());
+  EXPECT_TRUE(std::equal(c.begin(), c.end(), c2.begin(), c2.end()));
+}
+
+TEST_F(performance_test, clear_chain) {
+  // Deep enough to overflow the stack if clearing recursed along the chain.
+  constexpr int N = 1'000'000;
+
+  set<int, std::less<int>, std::allocator<int>, unbalanced_tree_policy> c;
+  for (int i = 0; i < N; ++i) {
+    c.insert(c.end(), i);
+  }
+  auto c2 = c;
+
+  c.clear();
+  expect_empty(c);
+  EXPECT_EQ(N, c2.size());
+  EXPECT_EQ(N - 1, *c2.rbegin());
+}
+
+TEST_F(performance_test, rebalance_chain) {
+  // Deep enough to overflow the stack if rebalancing recursed along the chain.
+  constexpr int N = 1'000'000;
+
+  set<int, std::less<int>, std::allocator<int>, unbalanced_tree_policy> c;
+  for (int i = 0; i < N; ++i) {
+    c.insert(c.end(), i);
+  }
+
+  c.rebalance();
+  EXPECT_EQ(std::bit_width(static_cast<size_t>(N)), c.height());
+  EXPECT_EQ(N, c.size());
+  EXPECT_EQ(N / 2, *c.find(N / 2));
+  int expected = 0;
+  for (int x : c) {
+    ASSERT_EQ(expected++, x);
+  }
+}
+
+TEST_F(performance_test, treap_insert_erase) {
+  constexpr size_t N = 1'000'000;
+
+  std::mt19937 rng(4243);
+  std::uniform_int_distribution value_dist(0, 1 << 20);
+
+  set<int, std::less<int>, std::allocator<int>, treap_policy<>> c;
+  std::vector<bool> present((1 << 20) + 1);
+  size_t count = 0;
+  for (size_t i = 0; i < N; ++i) {
+    int inserted = value_dist(rng);
+    int erased = value_dist(rng);
+    ASSERT_EQ(!present[inserted], c.insert(inserted).second);
+    count += !present[inserted];
+    present[inserted] = true;
+    ASSERT_EQ(present[erased] ? 1 : 0, c.erase(erased));
+    count -= present[erased];
+    present[erased] = false;
+  }
+  for (int i = 0; i < 1'000'000; ++i) {
+    c.insert(c.end(), (1 << 20) + i);
+  }
+
+  EXPECT_EQ(count + 1'000'000, c.size());
+  EXPECT_EQ((1 << 20) + 999'999, *c.rbegin());
+  // The expected height of a treap is below 2.1 log2 n.
+  EXPECT_LE(c.height(), 3 * std::bit_width(c.size()));
+}
+
+TEST_F(performance_test, scapegoat_insert_erase) {
+  constexpr size_t N = 1'000'000;
+
+  std::mt19937 rng(4244);
+  std::uniform_int_distribution value_dist(0, 1 << 20);
+
+  set<int, std::less<int>, std::allocator<int>, scapegoat_tree_policy> c;
+  std::vector<bool> present((1 << 20) + 1);
+  size_t count = 0;
+  for (size_t i = 0; i < N; ++i) {
+    int inserted = value_dist(rng);
+    int erased = value_dist(rng);
+    ASSERT_EQ(!present[inserted], c.insert(inserted).second);
+    count += !present[inserted];
+    present[inserted] = true;
+    ASSERT_EQ(present[erased] ? 1 : 0, c.erase(erased));
+    count -= present[erased];
+    present[erased] = false;
+  }
+  for (int i = 0; i < 1'000'000; ++i) {
+    c.insert(c.end(), (1 << 20) + i);
+  }
+
+  EXPECT_EQ(count + 1'000'000, c.size());
+  EXPECT_EQ((1 << 20) + 999'999, *c.rbegin());
+  EXPECT_LE(c.height(), static_cast<size_t>(std::log(static_cast<double>(c.size())) / std::log(1.5)) + 1);
+}
+
+TEST_F(performance_test, memory_per_element) {
+  constexpr size_t N = 100'000;
+
+  auto bytes_per_element = [&]<typename Policy>(Policy) {
+    size_t before = allocated_bytes();
+    set<std::int64_t, std::less<std::int64_t>, std::allocator<std::int64_t>, Policy> c;
+    for (size_t i = 0; i < N; ++i) {
+      c.insert(c.end(), static_cast<std::int64_t>(i));
+    }
+    return static_cast<double>(allocated_bytes() - before) / N;
+  };
+
+  double red_black = bytes_per_element(red_black_tree_policy());
+  double scapegoat = bytes_per_element(scapegoat_tree_policy());
+  double treap = bytes_per_element(treap_policy<>());
+  double splay = bytes_per_element(splay_tree_policy());
+  double order_statistics = bytes_per_element(with_order_statistics<>());
+  RecordProperty("red_black_bytes", static_cast<int>(red_black));
+  RecordProperty("scapegoat_bytes", static_cast<int>(scapegoat));
+  RecordProperty("treap_bytes", static_cast<int>(treap));
+  RecordProperty("splay_bytes", static_cast<int>(splay));
+  RecordProperty("order_statistics_bytes", static_cast<int>(order_statistics));
+
+  EXPECT_LT(scapegoat, red_black);
+  EXPECT_EQ(scapegoat, splay);
+  EXPECT_LE(scapegoat, treap);
+}
+
+TEST_F(performance_test, insert_ascending) {
+  constexpr size_t N = 1'000'000;
+
+  set<int> c;
+  for (size_t i = 0; i < N; ++i) {
+    c.insert(static_cast<int>(i));
+  }
+
+  EXPECT_EQ(N, c.size());
+  EXPECT_LE(c.height(), 2 * std::bit_width(N));
+}
+
+TEST_F(performance_test, insert_hint_ascending) {
+  constexpr size_t N = 1'000'000;
+
+  size_t comparisons = 0;
+  set<int, counting_less> c(counting_less{&comparisons});
+  for (size_t i = 0; i < N; ++i) {
+    c.insert(c.end(), static_cast<int>(i));
+  }
+
+  EXPECT_EQ(N, c.size());
+  EXPECT_EQ(N - 1, comparisons);
+  EXPECT_LE(c.height(), 2 * std::bit_width(N));
+}
+
+TEST_F(performance_test, split_join) {
+  constexpr int N = 1'000'000;
+  constexpr int K = 100'000;
+
+  std::vector<int> v(N);
+  std::iota(v.begin(), v.end(), 0);
+  size_t comparisons = 0;
+  set<int, counting_less, std::allocator<int>, with_order_statistics<>> c(sorted_unique, v.begin(), v.end(),
+                                                                          counting_less{&comparisons});
+
+  for (int i = 0; i < K; ++i) {
+    comparisons = 0;
+    auto [l, r] = c.split(i * 7919 % N);
+    c = join(std::move(l), std::move(r));
+    ASSERT_LE(comparisons, 4 * static_cast<size_t>(std::bit_width(static_cast<size_t>(N))));
+  }
+  EXPECT_EQ(N, c.size());
+  EXPECT_TRUE(std::equal(c.begin(), c.end(), v.begin(), v.end()));
+}
+
+TEST_F(performance_test, set_union_vs_std) {
+  std::vector<int> big(2'000'000), small(1'000);
+  std::iota(big.begin(), big.end(), 0);
+  for (size_t i = 0; i < small.size(); ++i) {
+    small[i] = static_cast<int>(i * 2'000 + 1);
+  }
+  std::atomic<size_t> comparisons = 0;
+  auto counting_less = [&comparisons](int a, int b) {
+    comparisons.fetch_add(1, std::memory_order_relaxed);
+    return a < b;
+  };
+  using counting_set = set<int, decltype(counting_less)>;
+  counting_set big_set(sorted_unique, big.begin(), big.end(), counting_less);
+  counting_set small_set(sorted_unique, small.begin(), small.end(), counting_less);
+
+  std::vector<int> merged;
+  std::set_union(big.begin(), big.end(), small.begin(), small.end(), std::back_inserter(merged));
+
+  comparisons = 0;
+  counting_set result = set_union(parallel, std::move(big_set), std::move(small_set));
+  EXPECT_LT(comparisons * 100, merged.size());
+  EXPECT_TRUE(std::equal(result.begin(), result.end(), merged.begin(), merged.end()));
+
+  std::vector<int> odd(1'000'000);
+  for (size_t i = 0; i < odd.size(); ++i) {
+    odd[i] = static_cast<int>(2 * i + 1);
+  }
+  counting_set lhs(sorted_unique, big.begin(), big.end(), counting_less);
+  counting_set rhs(sorted_unique, odd.begin(), odd.end(), counting_less);
+
+  counting_set interleaved = set_union(parallel, std::move(lhs), std::move(rhs));
+  EXPECT_EQ(2'000'000, interleaved.size());
+  EXPECT_TRUE(std::equal(interleaved.begin(), interleaved.end(), big.begin(), big.end()));
+}
+
+TEST_F(performance_test, range_ctor_sorted) {
+  constexpr size_t N = 1'000'000;
+
+  std::vector<int> v(N);
+  std::iota(v.begin(), v.end(), 0);
+
+  size_t comparisons = 0;
+  size_t allocations = allocations_made();
+  set<int, counting_less> c(v.begin(), v.end(), counting_less{&comparisons});
+
+  EXPECT_EQ(N, c.size());
+  EXPECT_EQ(N, allocations_made() - allocations);
+  EXPECT_EQ(N - 1, comparisons);
+  EXPECT_EQ(std::bit_width(N), c.height());
+}
+
+TEST_F(performance_test, iteration_step_latency) {
+  constexpr int N = 1'000'000;
+
+  std::vector<int> v(N);
+  std::iota(v.begin(), v.end(), 0);
+  set<int> plain(sorted_unique, v.begin(), v.end());
+  set<int, std::less<int>, std::allocator<int>, with_in_order_links<>> threaded(sorted_unique, v.begin(), v.end());
+
+  // Times every step separately and reports the 99.9th percentile and the worst step in nanoseconds.
+  auto step_latency = [&](const auto& c, const char* name) {
+    std::vector<std::chrono::steady_clock::duration> steps;
+    steps.reserve(N);
+    auto it = c.begin();
+    for (int i = 0; i < N; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      ++it;
+      steps.push_back(std::chrono::steady_clock::now() - start);
+    }
+    EXPECT_EQ(c.end(), it);
+    auto tail = steps.begin() + steps.size() * 999 / 1000;
+    std::nth_element(steps.begin(), tail, steps.end());
+    auto p999 = std::chrono::duration_cast<std::chrono::nanoseconds>(*tail).count();
+    auto worst = std::chrono::duration_cast<std::chrono::nanoseconds>(*std::max_element(tail, steps.end())).count();
+    RecordProperty(std::string(name) + "_p999_ns", static_cast<int>(p999));
+    RecordProperty(std::string(name) + "_max_ns", static_cast<int>(worst));
+  };
+
+  step_latency(plain, "plain");
+  step_latency(threaded, "threaded");
+  EXPECT_TRUE(std::equal(threaded.begin(), threaded.end(), v.begin(), v.end()));
+
+  // With in-order links a step reads only the link: nodes without parent and children are walked in both directions.
+  using node = set_detail::node_base<with_in_order_links<>>;
+  std::vector<node> nodes(1'000);
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    set_detail::chain(&nodes[i], &nodes[(i + 1) % nodes.size()]);
+  }
+  node* x = &nodes[0];
+  for (size_t i = 1; i <= nodes.size(); ++i) {
+    x = set_detail::successor(x);
+    ASSERT_EQ(&nodes[i % nodes.size()], x);
+  }
+  for (size_t i = nodes.size(); i-- > 0;) {
+    x = set_detail::predecessor(x);
+    ASSERT_EQ(&nodes[i], x);
+  }
+}
+
+TEST_F(performance_test, find_many_vs_find) {
+  constexpr int N = 1'000'000;
+  constexpr size_t K = 200'000;
+
+  std::vector<int> v(N);
+  std::iota(v.begin(), v.end(), 0);
+  set<int> c(sorted_unique, v.begin(), v.end());
+
+  std::vector<int> keys(K);
+  std::mt19937 rng(17);
+  std::uniform_int_distribution key_dist(0, 2 * N);
+  std::generate(keys.begin(), keys.end(), [&] { return key_dist(rng); });
+  std::vector<set<int>::const_iterator> out(K);
+
+  c.find_many(keys, out);
+  for (size_t i = 0; i < K; ++i) {
+    ASSERT_EQ(c.find(keys[i]), out[i]);
+  }
+}
+
 namespace {
 
 struct random_test_config {
@@ -1015,19 +2895,77 @@ struct random_test_config {
   double p_insert;
   double p_erase;
   double p_compare = .1;
+  // If positive, values follow a Zipf distribution with this exponent over the range of `value_dist`.
+  double zipf_exponent = 0;
+};
+
+// Draws values from [a, b] with probabilities proportional to 1 / rank^exponent,
+// the ranks being scattered over the range. Uses an alias table, so a draw is O(1).
+class zipf_distribution {
+public:
+  zipf_distribution(int a, int b, double exponent)
+      : first(a), range(static_cast<size_t>(b - a) + 1), prob(range), alias(range), column(0, range - 1) {
+    double total = 0;
+    for (size_t i = 0; i < range; ++i) {
+      prob[i] = std::pow(static_cast<double>(i + 1), -exponent);
+      total += prob[i];
+    }
+    // Each column keeps the share of its own rank and gives the rest to one rank that has too much.
+    std::vector<size_t> small, large;
+    for (size_t i = 0; i < range; ++i) {
+      prob[i] *= static_cast<double>(range) / total;
+      (prob[i] < 1 ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+      size_t s = small.back();
+      small.pop_back();
+      size_t l = large.back();
+      alias[s] = l;
+      prob[l] -= 1 - prob[s];
+      if (prob[l] < 1) {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+    for (size_t i : small) {
+      prob[i] = 1;
+    }
+    for (size_t i : large) {
+      prob[i] = 1;
+    }
+  }
+
+  int operator()(std::mt19937& rng) {
+    size_t i = column(rng);
+    size_t rank = share(rng) < prob[i] ? i : alias[i];
+    return first + static_cast<int>(rank * 1'000'003 % range);
+  }
+
+private:
+  int first;
+  size_t range;
+  std::vector<double> prob;
+  std::vector<size_t> alias;
+  std::uniform_int_distribution<size_t> column;
+  std::uniform_real_distribution<double> share;
 };
 
-void run_random_test(random_test_config cfg) {
+template <typename C = container>
+void run_random_test(random_test_config cfg, C my_set = C()) {
   std::mt19937 rng(cfg.seed);
 
   std::uniform_real_distribution real_dist;
 
   std::set<int> std_set;
-  container my_set;
+
+  std::optional<zipf_distribution> zipf;
+  if (cfg.zipf_exponent > 0) {
+    zipf.emplace(cfg.value_dist.a(), cfg.value_dist.b(), cfg.zipf_exponent);
+  }
 
   for (size_t i = 0; i < cfg.iterations; ++i) {
     double op = real_dist(rng);
-    int e = cfg.value_dist(rng);
+    int e = zipf ? (*zipf)(rng) : cfg.value_dist(rng);
 
     if (op < cfg.p_insert) {
       auto [std_it, std_ins] = std_set.insert(e);
@@ -1055,6 +2993,93 @@ void run_random_test(random_test_config cfg) {
 
 } // namespace
 
+TEST_F(performance_test, zipf_find_splay) {
+  constexpr int N = 100'000;
+  constexpr size_t K = 1'000'000;
+
+  size_t comparisons = 0;
+  auto counting_less = [&comparisons](int a, int b) {
+    ++comparisons;
+    return a < b;
+  };
+  std::vector<int> v(N);
+  std::iota(v.begin(), v.end(), 0);
+  set<int, decltype(counting_less)> balanced(sorted_unique, v.begin(), v.end(), counting_less);
+  set<int, decltype(counting_less), std::allocator<int>, splay_tree_policy> splay(sorted_unique, v.begin(), v.end(),
+                                                                                  counting_less);
+
+  // Nearly all lookups hit a few hundred hot keys.
+  std::mt19937 rng(4242);
+  zipf_distribution dist(0, N - 1, 1.5);
+  std::vector<int> keys(K);
+  std::generate(keys.begin(), keys.end(), [&] { return dist(rng); });
+
+  auto run = [&](const auto& c) {
+    comparisons = 0;
+    size_t found = 0;
+    for (int key : keys) {
+      found += c.find(key) != c.end();
+    }
+    EXPECT_EQ(K, found);
+    return comparisons;
+  };
+  size_t balanced_comparisons = run(balanced);
+  size_t splay_comparisons = run(splay);
+  EXPECT_LT(splay_comparisons * 5, balanced_comparisons * 3);
+}
+
+TEST_F(performance_test, finger_search_increasing) {
+  constexpr int N = 1'000'000;
+
+  size_t comparisons = 0;
+  auto counting_less = [&comparisons](int a, int b) {
+    ++comparisons;
+    return a < b;
+  };
+  std::vector<int> v(N);
+  std::iota(v.begin(), v.end(), 0);
+  set<int, decltype(counting_less)> c(sorted_unique, v.begin(), v.end(), counting_less);
+
+  // Increasing probes `stride` apart on average, looked up from the root and from the previous result.
+  std::mt19937 rng(4245);
+  for (int stride : {2, 32, 1'024}) {
+    std::uniform_int_distribution step_dist(1, 2 * stride - 1);
+    std::vector<int> keys;
+    for (int key = step_dist(rng); key < N; key += step_dist(rng)) {
+      keys.push_back(key);
+    }
+
+    comparisons = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int key : keys) {
+      ASSERT_EQ(key, *c.find(key));
+    }
+    auto root_time = std::chrono::steady_clock::now() - start;
+    size_t root_comparisons = comparisons;
+
+    comparisons = 0;
+    start = std::chrono::steady_clock::now();
+    auto finger = c.begin();
+    for (int key : keys) {
+      finger = c.find_from(finger, key);
+      ASSERT_EQ(key, *finger);
+    }
+    auto finger_time = std::chrono::steady_clock::now() - start;
+    size_t finger_comparisons = comparisons;
+
+    auto us = [](auto duration) {
+      return static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    };
+    std::string name = "stride_" + std::to_string(stride);
+    RecordProperty(name + "_root_comparisons", static_cast<int>(root_comparisons / keys.size()));
+    RecordProperty(name + "_finger_comparisons", static_cast<int>(finger_comparisons / keys.size()));
+    RecordProperty(name + "_root_us", us(root_time));
+    RecordProperty(name + "_finger_us", us(finger_time));
+
+    EXPECT_LT(finger_comparisons, (2 * std::bit_width(static_cast<unsigned>(stride)) + 4) * keys.size());
+  }
+}
+
 TEST_F(random_test, insert_find_scattered) {
   random_test_config cfg;
   cfg.seed = 1337;
@@ -1120,3 +3145,213 @@ TEST_F(random_test, insert_erase_find_dense_2) {
 
   run_random_test(cfg);
 }
+
+TEST_F(random_test, unbalanced_insert_erase_find_dense) {
+  random_test_config cfg;
+  cfg.seed = 1343;
+  cfg.value_dist = std::uniform_int_distribution(1, 500);
+  cfg.iterations = 100'000;
+  cfg.p_insert = .4;
+  cfg.p_erase = .2;
+
+  run_random_test<unbalanced_container>(cfg);
+}
+
+TEST_F(random_test, splay_insert_erase_find_dense) {
+  random_test_config cfg;
+  cfg.seed = 1346;
+  cfg.value_dist = std::uniform_int_distribution(1, 500);
+  cfg.iterations = 100'000;
+  cfg.p_insert = .4;
+  cfg.p_erase = .2;
+
+  run_random_test<splay_container>(cfg);
+}
+
+TEST_F(random_test, treap_insert_erase_find_dense) {
+  random_test_config cfg;
+  cfg.seed = 1348;
+  cfg.value_dist = std::uniform_int_distribution(1, 500);
+  cfg.iterations = 100'000;
+  cfg.p_insert = .4;
+  cfg.p_erase = .2;
+
+  run_random_test<set<element, std::less<element>, std::allocator<element>, treap_policy<1348>>>(cfg);
+}
+
+TEST_F(random_test, scapegoat_insert_erase_find_dense) {
+  random_test_config cfg;
+  cfg.seed = 1349;
+  cfg.value_dist = std::uniform_int_distribution(1, 500);
+  cfg.iterations = 100'000;
+  cfg.p_insert = .4;
+  cfg.p_erase = .2;
+
+  run_random_test<scapegoat_container>(cfg);
+}
+
+TEST_F(random_test, zipf_insert_erase_find) {
+  random_test_config cfg;
+  cfg.seed = 1347;
+  cfg.value_dist = std::uniform_int_distribution(1, 10'000);
+  cfg.iterations = 50'000;
+  cfg.p_insert = .3;
+  cfg.p_erase = .1;
+  cfg.zipf_exponent = 1.1;
+
+  run_random_test(cfg);
+}
+
+TEST_F(random_test, splay_zipf_insert_erase_find) {
+  random_test_config cfg;
+  cfg.seed = 1347;
+  cfg.value_dist = std::uniform_int_distribution(1, 10'000);
+  cfg.iterations = 50'000;
+  cfg.p_insert = .3;
+  cfg.p_erase = .1;
+  cfg.zipf_exponent = 1.1;
+
+  run_random_test<splay_container>(cfg);
+}
+
+TEST_F(random_test, pool_insert_erase_find_dense) {
+  random_test_config cfg;
+  cfg.seed = 1344;
+  cfg.value_dist = std::uniform_int_distribution(1, 500);
+  cfg.iterations = 100'000;
+  cfg.p_insert = .4;
+  cfg.p_erase = .3;
+
+  node_pool pool;
+  run_random_test(cfg, pool_container(pool_allocator<element>(pool)));
+}
+
+TEST_F(random_test, order_statistics) {
+  std::mt19937 rng(1345);
+  std::uniform_int_distribution value_dist(1, 500);
+  std::uniform_real_distribution real_dist;
+
+  std::set<int> std_set;
+  set<int, std::less<int>, std::allocator<int>, with_order_statistics<>> my_set;
+
+  for (size_t i = 0; i < 20'000; ++i) {
+    int e = value_dist(rng);
+    if (real_dist(rng) < .6) {
+      std_set.insert(e);
+      my_set.insert(e);
+    } else {
+      std_set.erase(e);
+      my_set.erase(e);
+    }
+
+    auto rank = static_cast<size_t>(std::distance(std_set.begin(), std_set.lower_bound(e)));
+    ASSERT_EQ(rank, my_set.rank(e));
+    if (rank < std_set.size()) {
+      ASSERT_EQ(*std_set.lower_bound(e), *my_set.nth(rank));
+    }
+    ASSERT_EQ(rank, my_set.index_of(my_set.lower_bound(e)));
+  }
+}
+
+TEST_F(random_test, split_join) {
+  std::mt19937 rng(8765);
+  std::uniform_int_distribution value_dist(1, 2'000);
+  std::uniform_real_distribution real_dist;
+
+  std::set<int> std_set;
+  set<int> my_set;
+
+  for (size_t i = 0; i < 5'000; ++i) {
+    for (size_t j = 0; j < 10; ++j) {
+      int e = value_dist(rng);
+      if (real_dist(rng) < .6) {
+        std_set.insert(e);
+        my_set.insert(e);
+      } else {
+        std_set.erase(e);
+        my_set.erase(e);
+      }
+    }
+
+    int key = value_dist(rng);
+    auto [l, r] = my_set.split(key);
+    ASSERT_TRUE(std::equal(l.begin(), l.end(), std_set.begin(), std_set.lower_bound(key)));
+    ASSERT_TRUE(std::equal(r.begin(), r.end(), std_set.lower_bound(key), std_set.end()));
+    ASSERT_EQ(std_set.size(), l.size() + r.size());
+    my_set = join(std::move(l), std::move(r));
+    ASSERT_EQ(std_set.size(), my_set.size());
+  }
+  ASSERT_TRUE(std::equal(my_set.begin(), my_set.end(), std_set.begin(), std_set.end()));
+}
+
+TEST_F(random_test, in_order_links) {
+  std::mt19937 rng(2468);
+  std::uniform_int_distribution value_dist(1, 2'000);
+  std::uniform_int_distribution op_dist(0, 9);
+
+  std::set<int> std_set;
+  set<int, std::less<int>, std::allocator<int>, with_in_order_links<>> my_set;
+
+  for (size_t i = 0; i < 20'000; ++i) {
+    int e = value_dist(rng);
+    int op = op_dist(rng);
+    if (op < 4) {
+      ASSERT_EQ(std_set.insert(e).second, my_set.insert(e).second);
+    } else if (op < 6) {
+      my_set.insert(my_set.lower_bound(e), e);
+      std_set.insert(e);
+    } else if (op < 8) {
+      ASSERT_EQ(std_set.erase(e), my_set.erase(e));
+    } else if (op < 9) {
+      auto nh = my_set.extract(e);
+      ASSERT_EQ(std_set.contains(e), !nh.empty());
+      my_set.insert(std::move(nh));
+    } else {
+      auto [l, r] = my_set.split(e);
+      my_set = join(std::move(l), std::move(r));
+    }
+
+    ASSERT_EQ(std_set.size(), my_set.size());
+    if (i % 100 == 0) {
+      ASSERT_TRUE(std::equal(my_set.begin(), my_set.end(), std_set.begin(), std_set.end()));
+      ASSERT_TRUE(std::equal(my_set.rbegin(), my_set.rend(), std_set.rbegin(), std_set.rend()));
+    }
+  }
+}
+
+TEST_F(random_test, set_operations) {
+  std::mt19937 rng(4321);
+  std::uniform_int_distribution value_dist(1, 1'000);
+  std::uniform_int_distribution size_dist(0, 300);
+
+  for (size_t i = 0; i < 1'000; ++i) {
+    std::set<int> a, b;
+    for (int n = size_dist(rng); n > 0; --n) {
+      a.insert(value_dist(rng));
+    }
+    for (int n = size_dist(rng); n > 0; --n) {
+      b.insert(value_dist(rng));
+    }
+
+    std::vector<int> expected;
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+    set<int> c = set_union(set<int>(a.begin(), a.end()), set<int>(b.begin(), b.end()));
+    ASSERT_EQ(expected.size(), c.size());
+    ASSERT_TRUE(std::equal(c.begin(), c.end(), expected.begin(), expected.end()));
+
+    expected.clear();
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+    c = set_intersection(set<int>(a.begin(), a.end()), set<int>(b.begin(), b.end()));
+    ASSERT_EQ(expected.size(), c.size());
+    ASSERT_TRUE(std::equal(c.begin(), c.end(), expected.begin(), expected.end()));
+
+    expected.clear();
+    std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+    c = set_difference(set<int>(a.begin(), a.end()), set<int>(b.begin(), b.end()));
+    ASSERT_EQ(expected.size(), c.size());
+    ASSERT_TRUE(std::equal(c.begin(), c.end(), expected.begin(), expected.end()));
+
+    c.insert(0);
+    c.erase(c.begin());
+  }
+}